@@ -0,0 +1,276 @@
+// benchmark image of the firmware hot functions
+//
+// the measured modules are included rather than linked
+// so their private functions can be called directly.
+// the image is run by sim_bench which reports the cycles per call.
+
+#include "bench.h"
+
+#include "tk-off.c"
+#undef IN_FIFO_SIZE
+#undef OUT_FIFO_SIZE
+
+#include "servo.c"
+#undef IN_FIFO_SIZE
+#undef OUT_FIFO_SIZE
+
+#include "mpu6050.c"
+#undef IN_FIFO_SIZE
+#undef OUT_FIFO_SIZE
+
+#include "cfg.h"
+
+#include "drivers/timer2.h"
+#include "utils/state_machine.h"
+
+#include "avr/sleep.h"
+
+#include "avr_mcu_section.h"
+
+AVR_MCU(16000000, "atmega328p");
+
+
+// ------------------------------------------
+// private definitions
+//
+
+#define TIMER2_TOP_VALUE	156	// @ 16 MHz ==> 10 ms
+
+#define BCH_CALLS		64		// calls per benchmark
+#define BCH_MPU_ITER_NB	16		// MPU_thread acquisitions measured
+
+#define BCH_MARK(id)	GPIOR0 = (id)
+
+// events of the benchmark state machine
+#define BCH_EV_A		1
+#define BCH_EV_B		2
+#define BCH_EV_C		3
+
+
+// ------------------------------------------
+// private variables
+//
+
+// inputs spread over the float range met by the Madgwick filter
+static const float BCH_floats[] PROGMEM = {
+	1e-6f, 0.01f, 0.5f, 1.0f, 2.0f, 3.0f, 100.0f, 4.2e6f,
+};
+
+// accelerations and rotations of a boost, raw values
+static const s16 BCH_imu[][6] PROGMEM = {
+	{ 2048, 0, 0, 0, 0, 0 },
+	{ 2100, 12, -8, 3, -2, 1 },
+	{ 6144, 150, -90, 40, -25, 12 },
+	{ 12288, -300, 210, -120, 80, -60 },
+	{ 9000, 40, 30, 500, -400, 300 },
+	{ -1024, -20, 60, -7, 9, -3 },
+	{ 0, 0, 0, 0, 0, 0 },			// skips the accelerometer feedback
+	{ 0, 0, 2048, 16384, -16384, 8192 },
+};
+
+static volatile float BCH_sink;
+
+// a state machine walking its whole transition chain on each event
+static u8 BCH_action(pt_t* pt, void* args);
+
+static const stm_state_t BCH_st_a;
+static const stm_state_t BCH_st_b;
+
+static const stm_transition_t BCH_a2b_3 = { .ev = BCH_EV_C, .st = &BCH_st_b, .tr = NULL, };
+static const stm_transition_t BCH_a2b_2 = { .ev = BCH_EV_B, .st = &BCH_st_a, .tr = &BCH_a2b_3, };
+static const stm_transition_t BCH_a2b_1 = { .ev = BCH_EV_A, .st = &BCH_st_a, .tr = &BCH_a2b_2, };
+static const stm_transition_t BCH_b2a_3 = { .ev = BCH_EV_C, .st = &BCH_st_a, .tr = NULL, };
+static const stm_transition_t BCH_b2a_2 = { .ev = BCH_EV_B, .st = &BCH_st_b, .tr = &BCH_b2a_3, };
+static const stm_transition_t BCH_b2a_1 = { .ev = BCH_EV_A, .st = &BCH_st_b, .tr = &BCH_b2a_2, };
+
+static const stm_state_t BCH_st_a = { .action = BCH_action, .transition = &BCH_a2b_1, };
+static const stm_state_t BCH_st_b = { .action = BCH_action, .transition = &BCH_b2a_1, };
+
+static stm_t BCH_stm;
+
+
+// ------------------------------------------
+// private functions
+//
+
+static void time(void* misc)
+{
+	(void)misc;
+
+	TIME_incr();
+}
+
+
+static u32 time_adjust(void)
+{
+	return TIME_get_incr() * TMR2_get_value() / TIMER2_TOP_VALUE;
+}
+
+
+static u8 BCH_action(pt_t* pt, void* args)
+{
+	PT_BEGIN(pt);
+
+	PT_YIELD_WHILE(pt, OK);
+
+	PT_END(pt);
+}
+
+
+static void BCH_imu_load(u8 i)
+{
+	TKF.acc_x = pgm_read_word(&BCH_imu[i][0]);
+	TKF.acc_y = pgm_read_word(&BCH_imu[i][1]);
+	TKF.acc_z = pgm_read_word(&BCH_imu[i][2]);
+	TKF.gyr_x = pgm_read_word(&BCH_imu[i][3]);
+	TKF.gyr_y = pgm_read_word(&BCH_imu[i][4]);
+	TKF.gyr_z = pgm_read_word(&BCH_imu[i][5]);
+}
+
+
+// pure computations, without interrupts
+static void BCH_compute(void)
+{
+	float x;
+	u8 i;
+
+	cli();
+
+	for (i = 0; i < BCH_CALLS; i++) {
+		BCH_MARK(BCH_EMPTY);
+		BCH_MARK(BCH_STOP);
+	}
+
+	for (i = 0; i < BCH_CALLS; i++) {
+		x = pgm_read_float(&BCH_floats[i % (sizeof(BCH_floats) / sizeof(BCH_floats[0]))]);
+		BCH_MARK(BCH_INV_SQRT);
+		BCH_sink = inv_sqrt(x);
+		BCH_MARK(BCH_STOP);
+	}
+
+	for (i = 0; i < BCH_CALLS; i++) {
+		BCH_imu_load(i % (sizeof(BCH_imu) / sizeof(BCH_imu[0])));
+		BCH_MARK(BCH_MADGWICK);
+		TKF_Madgwick();
+		BCH_MARK(BCH_STOP);
+	}
+
+	// below the threshold, then above it with the time-out running
+	TKF_config(3, 20);
+	for (i = 0; i < BCH_CALLS; i++) {
+		BCH_imu_load(i % (sizeof(BCH_imu) / sizeof(BCH_imu[0])));
+		BCH_MARK(BCH_TKF_COMPUTE);
+		(void)TKF_compute();
+		BCH_MARK(BCH_STOP);
+	}
+
+	for (i = 0; i < BCH_CALLS; i++) {
+		BCH_MARK(BCH_SRV_DRIVE);
+		SRV_drive(FR_SERVO_CONE, i & 1 ? FR_SERVO_CLOSE : FR_SERVO_OPEN);
+		BCH_MARK(BCH_STOP);
+	}
+
+	// the cone profile moves, holds then switches off
+	SRV.cone.slew = 3;
+	SRV.cone.hold = 1;
+	SRV_precompute(&SRV.cone);
+	SRV_drive(FR_SERVO_CONE, FR_SERVO_OPEN);
+	for (i = 0; i < BCH_CALLS; i++) {
+		BCH_MARK(BCH_SRV_TICK);
+		SRV_tick(NULL);
+		BCH_MARK(BCH_STOP);
+	}
+	SRV_drive(FR_SERVO_CONE, FR_SERVO_OFF);
+
+	// matching the last transition of the chain, then none
+	STM_init(&BCH_stm, &BCH_st_a);
+	for (i = 0; i < BCH_CALLS; i++) {
+		BCH_MARK(BCH_STM_EVENT);
+		STM_event(&BCH_stm, i & 1 ? BCH_EV_C + 1 : BCH_EV_C);
+		BCH_MARK(BCH_STOP);
+	}
+
+	for (i = 0; i < BCH_CALLS; i++) {
+		BCH_MARK(BCH_STM_RUN);
+		STM_run(&BCH_stm);
+		BCH_MARK(BCH_STOP);
+	}
+
+	sei();
+}
+
+
+// the MPU thread against the simulated bridge and MPU,
+// so the interrupts are on and may add to the max
+static void BCH_mpu(void)
+{
+	u8 n;
+
+	// the setup of the bridge and the MPU is not measured
+	while ( ! MPU.ready ) {
+		MPU_run();
+		DPT_run();
+	}
+
+	// as if the application start signal was received
+	MPU.started = 1;
+
+	n = 0;
+	while ( n < BCH_MPU_ITER_NB ) {
+		BCH_MARK(BCH_MPU_ITER);
+		MPU_run();
+
+		// an iteration ends when the thread waits for the next acquisition
+		if ( MPU.idle && TIME_get() < MPU.time_out ) {
+			BCH_MARK(BCH_STOP);
+			n++;
+
+			while ( TIME_get() < MPU.time_out ) {
+				DPT_run();
+				TKF_run();
+				SRV_run();
+			}
+		}
+		else {
+			BCH_MARK(BCH_PAUSE);
+		}
+
+		// dispatch the data frames outside of the measure
+		DPT_run();
+		TKF_run();
+	}
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+int main(void)
+{
+	TIME_init(time_adjust);
+	TIME_set_incr(10 * TIME_1_MSEC);
+
+	TMR2_init(TMR2_WITH_COMPARE_INT, TMR2_PRESCALER_1024, TMR2_WGM_CTC, TIMER2_TOP_VALUE, time, NULL);
+	TMR2_start();
+
+	sei();
+
+	CFG_init();
+	DPT_init();
+	POOL_init();
+	SRV_init();
+	MPU_init();
+	TKF_init();
+
+	BCH_compute();
+	BCH_mpu();
+
+	BCH_MARK(BCH_END);
+
+	// sleeping without interrupts stops the simulation
+	cli();
+	sleep_cpu();
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+#ifndef __BENCH_H__
+# define __BENCH_H__
+
+// microbenchmarks of the firmware hot functions
+//
+// shared by the benchmark image (bench.c) and its simavr runner (sim_bench.c).
+//
+// the image brackets each measured call with markers written in GPIOR0 :
+//	- an id starts (or resumes) the measure of this benchmark,
+//	- BCH_STOP ends the measure and accounts it as 1 call,
+//	- BCH_PAUSE suspends the measure, the call goes on at the next id,
+//	- BCH_END ends the run.
+// the runner takes the cycle counter at each marker,
+// and removes the marker cost measured by the empty benchmark.
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// GPIOR0 in the data space of the ATmega328P
+#define BCH_MARKER_ADDR	0x3e
+
+#define BCH_STOP		0x00
+#define BCH_PAUSE		0xfe
+#define BCH_END			0xff
+
+// benchmark ids, the order is the one of the runner report
+typedef enum {
+	BCH_EMPTY = 1,		// markers only, to calibrate their cost
+	BCH_INV_SQRT,		// inv_sqrt()
+	BCH_MADGWICK,		// TKF_Madgwick()
+	BCH_TKF_COMPUTE,	// TKF_compute()
+	BCH_SRV_DRIVE,		// SRV_drive() on the cone
+	BCH_SRV_TICK,		// SRV_tick(), the TIMER1 overflow work
+	BCH_STM_EVENT,		// STM_event()
+	BCH_STM_RUN,		// STM_run()
+	BCH_MPU_ITER,		// MPU_run() calls over 1 MPU_thread acquisition
+	BCH_NB,
+} bch_id_t;
+
+#endif	// __BENCH_H__
@@ -0,0 +1,278 @@
+//
+// co-simulation of several boards, see cosim.h
+//
+
+#define _POSIX_C_SOURCE 200809L	// pthread_barrier_t
+
+#include "cosim.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "sim_io.h"			// avr_io_getirq()
+#include "avr_uart.h"		// AVR_IOCTL_UART_GETIRQ()
+
+
+//--------------------------------------------------------------------
+// private defines
+//
+
+#define COSIM_CORES_MAX	8
+#define COSIM_LINKS_MAX	8
+
+#define RING_SIZE		256		// shall be a power of 2
+
+
+//--------------------------------------------------------------------
+// private structure definitions
+//
+
+typedef struct {
+	avr_cycle_count_t cycle;	// cycle of the sending core
+	uint8_t byte;
+} cosim_msg_t;
+
+// single-producer single-consumer ring
+// the head is only written by the sending core thread,
+// the tail only by the receiving core thread
+typedef struct {
+	cosim_msg_t msg[RING_SIZE];
+	unsigned int head;
+	unsigned int tail;
+	unsigned int lost;			// messages dropped on a full ring
+} cosim_ring_t;
+
+typedef struct {
+	cosim_ring_t ring;
+	avr_t* from;
+	avr_t* to;
+	avr_irq_t* in;				// input of the receiving UART
+} cosim_link_t;
+
+typedef struct {
+	struct cosim_t* cs;
+	avr_t* avr;
+	cosim_step_t step;
+	int state;					// last state returned by avr_run()
+	pthread_t thread;
+} cosim_core_t;
+
+typedef struct cosim_t {
+	avr_cycle_count_t quantum;
+	avr_cycle_count_t common;	// cycle reached by every core
+
+	cosim_core_t core[COSIM_CORES_MAX];
+	int core_nb;
+
+	cosim_link_t link[COSIM_LINKS_MAX];
+	int link_nb;
+
+	cosim_sync_t sync;
+	void* param;
+
+	// the stop flag is only written between the 2 barriers of a quantum
+	pthread_barrier_t barrier;
+	int stop;
+	int error;					// index of the core in error, -1 if none
+} cosim_t;
+
+
+//--------------------------------------------------------------------
+// private functions
+//
+
+// called in the thread of the sending core
+static void cosim_uart_out_hook(struct avr_irq_t* irq, uint32_t value, void* param)
+{
+	cosim_link_t* l = param;
+	cosim_ring_t* r = &l->ring;
+	unsigned int head = r->head;
+
+	(void)irq;
+
+	if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= RING_SIZE) {
+		r->lost++;
+		return;
+	}
+
+	r->msg[head & (RING_SIZE - 1)].cycle = l->from->cycle;
+	r->msg[head & (RING_SIZE - 1)].byte = value;
+	__atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+}
+
+
+// deliver to a core the messages sent before the current quantum
+static void cosim_deliver(cosim_t* cs, cosim_core_t* core)
+{
+	for (int i = 0; i < cs->link_nb; i++) {
+		cosim_link_t* l = &cs->link[i];
+		cosim_ring_t* r = &l->ring;
+		unsigned int tail = r->tail;
+		unsigned int head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+
+		if (l->to != core->avr)
+			continue;
+
+		while (tail != head && r->msg[tail & (RING_SIZE - 1)].cycle < cs->common) {
+			avr_raise_irq(l->in, r->msg[tail & (RING_SIZE - 1)].byte);
+			tail++;
+		}
+		__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+	}
+}
+
+
+// run a core up to the end of the current quantum
+// in lockstep, a core behind the others runs a single instruction
+static void cosim_quantum(cosim_t* cs, cosim_core_t* core)
+{
+	avr_cycle_count_t end = cs->common + (cs->quantum ? cs->quantum : 1);
+
+	cosim_deliver(cs, core);
+
+	while (core->avr->cycle < end) {
+		core->state = avr_run(core->avr);
+		if ((core->state == cpu_Done) || (core->state == cpu_Crashed))
+			return;
+
+		if (core->step)
+			core->step(core->avr);
+	}
+}
+
+
+// called once every core has run its quantum
+// returns non-zero to stop
+static int cosim_sync(cosim_t* cs)
+{
+	avr_cycle_count_t min = cs->core[0].avr->cycle;
+
+	for (int i = 0; i < cs->core_nb; i++) {
+		if ((cs->core[i].state == cpu_Done) || (cs->core[i].state == cpu_Crashed)) {
+			cs->error = i;
+			return 1;
+		}
+		if (cs->core[i].avr->cycle < min)
+			min = cs->core[i].avr->cycle;
+	}
+	if (min > cs->common)
+		cs->common = min;
+
+	return cs->sync ? cs->sync(cs->common, cs->param) : 0;
+}
+
+
+static void* cosim_thread(void* arg)
+{
+	cosim_core_t* core = arg;
+	cosim_t* cs = core->cs;
+
+	while (1) {
+		cosim_quantum(cs, core);
+
+		// a single thread checks the end of the quantum
+		if (PTHREAD_BARRIER_SERIAL_THREAD == pthread_barrier_wait(&cs->barrier))
+			cs->stop = cosim_sync(cs);
+		pthread_barrier_wait(&cs->barrier);
+
+		if (cs->stop)
+			break;
+	}
+
+	return NULL;
+}
+
+
+//--------------------------------------------------------------------
+// public functions
+//
+
+struct cosim_t* cosim_alloc(avr_cycle_count_t quantum)
+{
+	cosim_t* cs;
+
+	cs = malloc(sizeof(cosim_t));
+	memset(cs, 0, sizeof(cosim_t));
+
+	cs->quantum = quantum;
+	cs->error = -1;
+
+	return cs;
+}
+
+
+void cosim_free(struct cosim_t* cs)
+{
+	for (int i = 0; i < cs->link_nb; i++) {
+		if (cs->link[i].ring.lost)
+			fprintf(stderr, "link #%d: %u bytes lost\n", i, cs->link[i].ring.lost);
+	}
+
+	free(cs);
+}
+
+
+int cosim_add(struct cosim_t* cs, avr_t* avr, cosim_step_t step)
+{
+	if (cs->core_nb >= COSIM_CORES_MAX)
+		return -1;
+
+	cs->core[cs->core_nb].cs = cs;
+	cs->core[cs->core_nb].avr = avr;
+	cs->core[cs->core_nb].step = step;
+	cs->core[cs->core_nb].state = cpu_Running;
+
+	return cs->core_nb++;
+}
+
+
+int cosim_link_uart(struct cosim_t* cs, avr_t* from, char from_uart, avr_t* to, char to_uart)
+{
+	cosim_link_t* l;
+
+	if (cs->link_nb >= COSIM_LINKS_MAX)
+		return -1;
+
+	l = &cs->link[cs->link_nb++];
+	l->from = from;
+	l->to = to;
+	l->in = avr_io_getirq(to, AVR_IOCTL_UART_GETIRQ(to_uart), UART_IRQ_INPUT);
+
+	avr_irq_register_notify(avr_io_getirq(from, AVR_IOCTL_UART_GETIRQ(from_uart), UART_IRQ_OUTPUT),
+			cosim_uart_out_hook, l);
+
+	return 0;
+}
+
+
+int cosim_run(struct cosim_t* cs, int threaded, cosim_sync_t sync, void* param)
+{
+	cs->sync = sync;
+	cs->param = param;
+	cs->stop = 0;
+
+	if (!threaded) {
+		while (!cs->stop) {
+			for (int i = 0; i < cs->core_nb; i++)
+				cosim_quantum(cs, &cs->core[i]);
+
+			cs->stop = cosim_sync(cs);
+		}
+
+		return cs->error;
+	}
+
+	pthread_barrier_init(&cs->barrier, NULL, cs->core_nb);
+
+	for (int i = 0; i < cs->core_nb; i++)
+		pthread_create(&cs->core[i].thread, NULL, cosim_thread, &cs->core[i]);
+
+	for (int i = 0; i < cs->core_nb; i++)
+		pthread_join(cs->core[i].thread, NULL);
+
+	pthread_barrier_destroy(&cs->barrier);
+
+	return cs->error;
+}
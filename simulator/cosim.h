@@ -0,0 +1,47 @@
+//
+// co-simulation of several boards
+//
+// each core runs by quantum of cycles then waits for the others at a barrier,
+// so no core is ever more than a quantum ahead of the slowest one.
+// the cores run either in turn on the calling thread or each on its own thread.
+//
+// the traffic between boards (UART) is queued in single-producer single-consumer
+// lock-free rings, stamped with the cycle it was sent.
+// it is delivered to the receiving core at the start of the next quantum,
+// so the cross-core latency is at most a quantum.
+
+#ifndef __COSIM_H__
+# define __COSIM_H__
+
+# include "sim_avr.h"
+
+
+// called after each instruction of a core, in the thread of the core
+typedef void (*cosim_step_t)(avr_t* avr);
+
+// called once all the cores reached the end of a quantum, by a single thread
+// common is the cycle reached by every core
+// returns non-zero to stop the simulation
+typedef int (*cosim_sync_t)(avr_cycle_count_t common, void* param);
+
+
+// create a co-simulation running the cores by quantum of cycles,
+// a quantum of 0 runs them in lockstep, one instruction each
+struct cosim_t* cosim_alloc(avr_cycle_count_t quantum);
+
+// release the co-simulation, not the cores
+void cosim_free(struct cosim_t* cs);
+
+// add a core, step may be NULL
+// returns the index of the core or -1 if too many
+int cosim_add(struct cosim_t* cs, avr_t* avr, cosim_step_t step);
+
+// forward the bytes sent by a UART of a core to a UART of another
+// returns -1 if too many links
+int cosim_link_uart(struct cosim_t* cs, avr_t* from, char from_uart, avr_t* to, char to_uart);
+
+// run until a core stops or sync requests it
+// returns the index of the core in error or -1
+int cosim_run(struct cosim_t* cs, int threaded, cosim_sync_t sync, void* param);
+
+#endif	// __COSIM_H__
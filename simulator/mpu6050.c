@@ -27,6 +27,7 @@
 // quite basic simulation of the MPU-6050 I2C component
 //
 // it can be configured to connect to the I2C bus of the simulated SC18IS600
+// its INT pin is wired to INT0 of the AVR and reports the motions
 
 #include "mpu6050.h"
 
@@ -35,8 +36,10 @@
 #include <string.h>
 #include "sim_avr.h"
 #include "avr_twi.h"
+#include "avr_ioport.h"
 
 #include "sc18is600.h"
+#include "trace.h"
 
 //--------------------------------------------------------------------
 // private defines
@@ -44,6 +47,19 @@
 
 #define NB_REGS	0x100
 
+#define PROFIL_MAX	64		// points of a profile file
+
+#define MPU_MOT_THR		0x1f	// motion threshold, 2 mg per unit
+#define MPU_INT_ENABLE	0x38
+#define MPU_INT_STATUS	0x3a	// cleared on read
+#define MPU_DATA_RDY	0x01	// INT_ENABLE and INT_STATUS data ready bit
+#define MPU_MOT_INT		0x40	// INT_ENABLE and INT_STATUS motion bit
+
+#define MPU_INT_PORT	'D'		// INT pin wired to INT0
+#define MPU_INT_PIN		2
+
+#define SAMPLE_PERIOD	10000	// sampling period in us
+
 
 //--------------------------------------------------------------------
 // private structure definitions
@@ -52,6 +68,7 @@
 typedef enum {
     MPU_IRQ_IN,
     MPU_IRQ_OUT,
+    MPU_IRQ_INT,
     MPU_IRQ_COUNT,
 } _mpu_irq_t;
 
@@ -75,6 +92,8 @@ typedef struct mpu6050_t {
 	uint8_t current_reg;	// current accessed register
 	int write_step;			// to handle modification of the register index
 	uint8_t regs[NB_REGS];	// internal register map
+
+	int16_t acc[3];			// previous acceleration sample for the motion detection
 } mpu6050_t;
 
 
@@ -115,7 +134,12 @@ static struct {
 	uint16_t gyr_z;
 
 	struct simu_profil_t * profil;
-} simu;
+	unsigned int nb;		// points of the profile
+} simu = {
+	// the built-in profile unless a file is loaded, sim_bench relies on it too
+	.profil = profil,
+	.nb = sizeof(profil) / sizeof(profil[0]),
+};
 
 # define BRIGHT_COLOR   "\x1b[95m"
 # define NORMAL_COLOR   "\x1b[0m"
@@ -136,6 +160,9 @@ static char* msg2chr[] = {
 // private variables
 //
 
+// profile read from a file
+static struct simu_profil_t profil_file[PROFIL_MAX];
+
 
 //--------------------------------------------------------------------
 // private functions
@@ -182,12 +209,12 @@ static void simu_update(int cycle, int freq, uint8_t* regs)
 	float date = 1. * cycle / freq;
 
 	// linear interpolation of the values
-	for (unsigned int i = 0; i < sizeof(profil) / sizeof(profil[0]); i++) {
+	for (unsigned int i = 0; i < simu.nb; i++) {
 		const struct simu_profil_t * prof1 = &simu.profil[i];
 		const struct simu_profil_t * prof2 = NULL;
 
 		// check if upper bound is available
-		if ( i + 1 < sizeof(profil) / sizeof(profil[0]) ) {
+		if ( i + 1 < simu.nb ) {
 			prof2 = &simu.profil[i + 1];
 		}
 
@@ -221,6 +248,45 @@ static void simu_update(int cycle, int freq, uint8_t* regs)
 }
 
 
+// periodic sampling : flag the data ready and detect the motions
+static avr_cycle_count_t mpu6050_sample(struct avr_t * avr, avr_cycle_count_t when, void * param)
+{
+	mpu6050_t * mpu = (mpu6050_t*)param;
+	int16_t acc[3];
+	int thr;
+	int motion = 0;
+
+	simu_update(avr->cycle, avr->frequency, mpu->regs + 0x3b);
+	mpu->regs[MPU_INT_STATUS] |= MPU_DATA_RDY;
+
+	// the high-pass filtered acceleration is approximated
+	// by the change since the previous sample
+	acc[0] = simu.acc_x;
+	acc[1] = simu.acc_y;
+	acc[2] = simu.acc_z;
+
+	// 2 mg per unit of threshold, 2048 per g at +-16G
+	thr = mpu->regs[MPU_MOT_THR] * 2 * 2048 / 1000;
+	for (int i = 0; i < 3; i++) {
+		if ( abs(acc[i] - mpu->acc[i]) > thr ) {
+			motion = 1;
+		}
+		mpu->acc[i] = acc[i];
+	}
+
+	if ( motion && (mpu->regs[MPU_INT_ENABLE] & MPU_MOT_INT) ) {
+		TRACE(avr, TRC_MPU, TRC_DEBUG, BRIGHT_COLOR"MPU"NORMAL_COLOR": motion interrupt\n");
+		mpu->regs[MPU_INT_STATUS] |= MPU_MOT_INT;
+
+		// a 50 us pulse on the real component, only its rising edge matters
+		avr_raise_irq(mpu->irq + MPU_IRQ_INT, 1);
+		avr_raise_irq(mpu->irq + MPU_IRQ_INT, 0);
+	}
+
+	return when + avr_usec_to_cycles(avr, SAMPLE_PERIOD);
+}
+
+
 // called on every I2C transaction
 static void mpu6050_i2c_in_hook(struct avr_irq_t * irq, uint32_t value, void * param)
 {
@@ -231,7 +297,7 @@ static void mpu6050_i2c_in_hook(struct avr_irq_t * irq, uint32_t value, void * p
 
 	msg.v = value;
 
-	printf(BRIGHT_COLOR"MPU"NORMAL_COLOR": %s st:%d msg %s  addr 0x%02x+%c / data 0x%02x", __func__, mpu->state, msg2chr[msg.bus.msg], msg.bus.data >> 1, msg.bus.data & 0x01 ? 'R' : 'W', msg.bus.data);
+	TRACE(mpu->avr, TRC_MPU, TRC_DEBUG, BRIGHT_COLOR"MPU"NORMAL_COLOR": %s st:%d msg %s  addr 0x%02x+%c / data 0x%02x\n", __func__, mpu->state, msg2chr[msg.bus.msg], msg.bus.data >> 1, msg.bus.data & 0x01 ? 'R' : 'W', msg.bus.data);
 
 	switch (mpu->state) {
 	case MPU_FSM_IDLE:
@@ -245,13 +311,11 @@ static void mpu6050_i2c_in_hook(struct avr_irq_t * irq, uint32_t value, void * p
 		if (msg.bus.msg == TWI_MSG_STOP) {
 			mpu->bus = 0;
 		}
-		printf("\n");
 		break;
 
 	case MPU_FSM_STARTED:
 		// self address received ?
 		if (msg.bus.msg == TWI_MSG_ADDR && (mpu->self_addr << 1) == (msg.bus.addr & 0xfe)) {
-			printf("\n");
 			// ack
 			msg = avr_twi_irq_msg(TWI_MSG_ACK, mpu->self_addr);
 			avr_raise_irq(mpu->irq + MPU_IRQ_OUT, msg.v);
@@ -270,7 +334,6 @@ static void mpu6050_i2c_in_hook(struct avr_irq_t * irq, uint32_t value, void * p
 		}
 		// bad address !
 		else {
-			printf("\n");
 			// nack
 			msg = avr_twi_irq_msg(TWI_MSG_NACK, mpu->self_addr);
 			avr_raise_irq(mpu->irq + MPU_IRQ_OUT, msg.v);
@@ -293,7 +356,6 @@ static void mpu6050_i2c_in_hook(struct avr_irq_t * irq, uint32_t value, void * p
 			// and points to next register
 			mpu->current_reg++;
 		}
-		printf("\n");
 
 		// ack
 		msg = avr_twi_irq_msg(TWI_MSG_ACK, mpu->self_addr);
@@ -314,12 +376,16 @@ static void mpu6050_i2c_in_hook(struct avr_irq_t * irq, uint32_t value, void * p
 			msg = avr_twi_irq_msg(TWI_MSG_DATA, 0x68);
 			break;
 
+		case MPU_INT_STATUS:
+			msg = avr_twi_irq_msg(TWI_MSG_DATA, mpu->regs[mpu->current_reg]);
+			mpu->regs[mpu->current_reg] = 0;
+			break;
+
 		default:
 			msg = avr_twi_irq_msg(TWI_MSG_DATA, mpu->regs[mpu->current_reg]);
 			break;
 		}
 
-		printf("\n");
         // send the data
 		avr_raise_irq(mpu->irq + MPU_IRQ_OUT, msg.v);
 
@@ -328,7 +394,6 @@ static void mpu6050_i2c_in_hook(struct avr_irq_t * irq, uint32_t value, void * p
 		break;
 
 	default:
-		printf("\n");
 		break;
 	}
 }
@@ -336,6 +401,7 @@ static void mpu6050_i2c_in_hook(struct avr_irq_t * irq, uint32_t value, void * p
 static const char * mpu_irq_names[MPU_IRQ_COUNT] = {
 		[MPU_IRQ_IN] = "mpu6050.in",
 		[MPU_IRQ_OUT] = "mpu6050.out",
+		[MPU_IRQ_INT] = "mpu6050.int",
 };
 
 
@@ -367,6 +433,12 @@ struct mpu6050_t* mpu6050_alloc(struct avr_t * avr, uint8_t addr, struct sc18is6
 		avr_connect_irq(avr_io_getirq(avr, i2c_irq_base, TWI_IRQ_OUTPUT), mpu->irq + MPU_IRQ_IN);
 	}
 
+	// the INT pin drives the INT0 input of the AVR
+	avr_connect_irq(mpu->irq + MPU_IRQ_INT, avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ(MPU_INT_PORT), MPU_INT_PIN));
+
+	// sample the profile at a regular pace
+	avr_cycle_timer_register_usec(avr, SAMPLE_PERIOD, mpu6050_sample, mpu);
+
 	return mpu;
 }
 
@@ -376,3 +448,74 @@ void mpu6050_free(struct mpu6050_t* mpu)
 	free(mpu);
 }
 
+
+float mpu6050_step_date(void)
+{
+	// the step starts at the last point of the initial X acceleration
+	for (unsigned int i = 1; i < simu.nb; i++) {
+		if ( simu.profil[i].acc_x != simu.profil[0].acc_x ) {
+			return simu.profil[i - 1].date;
+		}
+	}
+
+	return -1.;
+}
+
+
+int mpu6050_profile_load(const char* fname)
+{
+	struct simu_profil_t * p;
+	char buf[256];
+	unsigned int line = 0;
+	unsigned int nb = 0;
+	FILE* fd;
+
+	fd = fopen(fname, "r");
+	if (!fd) {
+		perror(fname);
+		return -1;
+	}
+
+	while (fgets(buf, sizeof(buf), fd)) {
+		line++;
+
+		// skip the comments and the empty lines
+		char* c = strchr(buf, '#');
+		if (c)
+			*c = '\0';
+		if (strspn(buf, " \t\r\n") == strlen(buf))
+			continue;
+
+		if (nb >= PROFIL_MAX) {
+			fprintf(stderr, "%s:%u: more than %d points\n", fname, line, PROFIL_MAX);
+			fclose(fd);
+			return -1;
+		}
+
+		p = &profil_file[nb];
+		if (8 != sscanf(buf, "%f %f %f %f %f %f %f %f", &p->date, &p->acc_x, &p->acc_y, &p->acc_z, &p->temp, &p->gyr_x, &p->gyr_y, &p->gyr_z)) {
+			fprintf(stderr, "%s:%u: 8 values expected\n", fname, line);
+			fclose(fd);
+			return -1;
+		}
+
+		if (nb && p->date <= profil_file[nb - 1].date) {
+			fprintf(stderr, "%s:%u: dates shall increase\n", fname, line);
+			fclose(fd);
+			return -1;
+		}
+
+		nb++;
+	}
+	fclose(fd);
+
+	if (!nb) {
+		fprintf(stderr, "%s: empty profile\n", fname);
+		return -1;
+	}
+
+	simu.profil = profil_file;
+	simu.nb = nb;
+
+	return 0;
+}
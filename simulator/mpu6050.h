@@ -42,4 +42,15 @@ struct mpu6050_t* mpu6050_alloc(struct avr_t * avr, uint8_t addr, struct sc18is6
 void mpu6050_free(struct mpu6050_t* mpu);
 
 
+// date [s] of the start of the first X acceleration step of the profile, -1 if none
+float mpu6050_step_date(void);
+
+
+// replace the built-in measure profile by the one of a file
+// each line holds the 8 columns of the built-in one :
+// date [s], acc x [g], acc y, acc z, temp [C], gyr x, gyr y, gyr z
+// returns -1 on error
+int mpu6050_profile_load(const char* fname);
+
+
 #endif	// __MPU6050_H__
@@ -39,6 +39,8 @@
 #include "avr_ioport.h"		// AVR_IOCTL_IOPORT_GETSTATE()
 #include "sim_io.h"			// avr_ioctl()
 
+#include "trace.h"
+
 
 //--------------------------------------------------------------------
 // private defines
@@ -178,7 +180,7 @@ typedef struct sc18is600_t {
 // write n bytes to I2C-bus slave device
 static void sc18_wr_n(sc18is600_t * sc18, sc18_hook_t hook)
 {
-	printf(YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s src:%s CS:%d st:%d\n", sc18->avr->tag_name, __func__, (hook == SC18_FROM_I2C_HOOK) ? "I2C" : "SPI", sc18->cs, sc18->step);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s src:%s CS:%d st:%d\n", sc18->avr->tag_name, __func__, (hook == SC18_FROM_I2C_HOOK) ? "I2C" : "SPI", sc18->cs, sc18->step);
 
 	avr_twi_msg_irq_t msg;
 
@@ -236,7 +238,7 @@ static void sc18_wr_n(sc18is600_t * sc18, sc18_hook_t hook)
 
     // some boundary checks
     if ( sc18->wr_n.index > SC18_TX_BUF_SIZE ) {
-        printf(YELLOW_COLOR"SC18"NORMAL_COLOR": buffer overflow %02d\n", sc18->wr_n.index);
+        TRACE(sc18->avr, TRC_SC18, TRC_ERROR, YELLOW_COLOR"SC18"NORMAL_COLOR": buffer overflow %02d\n", sc18->wr_n.index);
 
         // force I2C stop
         msg = avr_twi_irq_msg(TWI_MSG_STOP, sc18->wr_n.i2c_addr);
@@ -252,20 +254,20 @@ static void sc18_wr_n(sc18is600_t * sc18, sc18_hook_t hook)
 // read n bytes to I2C-bus slave device
 static void sc18_rd_n(sc18is600_t * sc18, sc18_hook_t hook, uint32_t value)
 {
-	printf(YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s src:%s CS:%d st:%d\t", sc18->avr->tag_name, __func__, (hook == SC18_FROM_I2C_HOOK) ? "I2C" : "SPI", sc18->cs, sc18->step);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s src:%s CS:%d st:%d\t", sc18->avr->tag_name, __func__, (hook == SC18_FROM_I2C_HOOK) ? "I2C" : "SPI", sc18->cs, sc18->step);
 
 	avr_twi_msg_irq_t msg = { .v = value };
 
     if ( hook == SC18_FROM_I2C_HOOK ) {
         // when I2C slave is responding
-		printf("msg %s  addr 0x%02x+%c / data 0x%02x\n", msg2chr[msg.bus.msg], msg.bus.data >> 1, msg.bus.data & 0x01 ? 'R' : 'W', msg.bus.data);
+		TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "msg %s  addr 0x%02x+%c / data 0x%02x\n", msg2chr[msg.bus.msg], msg.bus.data >> 1, msg.bus.data & 0x01 ? 'R' : 'W', msg.bus.data);
 
         // only store the received data
         sc18->rx_buf[sc18->rd_n.index] = msg.bus.data;
         return;
     }
 
-	printf("\n");
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "\n");
 
 	// step #0: start
 	if ( sc18->step == 0 ) {
@@ -316,7 +318,7 @@ static void sc18_rd_n(sc18is600_t * sc18, sc18_hook_t hook, uint32_t value)
 
     // some boundary checks
     if ( sc18->wr_n.index > SC18_TX_BUF_SIZE ) {
-        printf(YELLOW_COLOR"SC18"NORMAL_COLOR": buffer overflow %02d\n", sc18->wr_n.index);
+        TRACE(sc18->avr, TRC_SC18, TRC_ERROR, YELLOW_COLOR"SC18"NORMAL_COLOR": buffer overflow %02d\n", sc18->wr_n.index);
 
         // force the I2C stop
         msg = avr_twi_irq_msg(TWI_MSG_STOP, 0);
@@ -332,11 +334,11 @@ static void sc18_rd_n(sc18is600_t * sc18, sc18_hook_t hook, uint32_t value)
 // I2C-bus write then read (read after write)
 static void sc18_wr_rd(sc18is600_t * sc18, sc18_hook_t hook)
 {
-	printf(YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
 
 	(void)hook;
 
-    printf(YELLOW_COLOR"SC18"NORMAL_COLOR": not implemented yet! ");
+    TRACE(sc18->avr, TRC_SC18, TRC_ERROR, YELLOW_COLOR"SC18"NORMAL_COLOR": not implemented yet!\n");
     sc18->fini = 1;
 
 	// step #0 is the command
@@ -346,7 +348,7 @@ static void sc18_wr_rd(sc18is600_t * sc18, sc18_hook_t hook)
 
     // next steps up to limit are for writing the buffer
     if ( sc18->step > SC18_TX_BUF_SIZE ) {
-        printf(YELLOW_COLOR"SC18"NORMAL_COLOR": too many data %d ", sc18->step);
+        TRACE(sc18->avr, TRC_SC18, TRC_ERROR, YELLOW_COLOR"SC18"NORMAL_COLOR": too many data %d\n", sc18->step);
         return;
     }
 }
@@ -355,7 +357,7 @@ static void sc18_wr_rd(sc18is600_t * sc18, sc18_hook_t hook)
 // read buffer
 static uint8_t sc18_rd_buf(uint8_t value, sc18is600_t * sc18)
 {
-	printf("%s ", __func__);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "%s ", __func__);
 
 	(void)value;
 
@@ -366,7 +368,7 @@ static uint8_t sc18_rd_buf(uint8_t value, sc18is600_t * sc18)
 
     // next steps up to limit are for reading the buffer
     if ( sc18->step > SC18_RX_BUF_SIZE ) {
-        printf(" offset out of bound %d ", sc18->step);
+        TRACE(sc18->avr, TRC_SC18, TRC_ERROR, " offset out of bound %d\n", sc18->step);
         return 0xff;
     }
 
@@ -378,11 +380,11 @@ static uint8_t sc18_rd_buf(uint8_t value, sc18is600_t * sc18)
 // I2C-bus write after write
 static void sc18_wr_wr(sc18is600_t * sc18, sc18_hook_t hook)
 {
-	printf(YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
 
 	(void)hook;
 
-    printf(YELLOW_COLOR"SC18"NORMAL_COLOR": not implemented yet! ");
+    TRACE(sc18->avr, TRC_SC18, TRC_ERROR, YELLOW_COLOR"SC18"NORMAL_COLOR": not implemented yet!\n");
     sc18->fini = 1;
 
 	// step #0 is the command
@@ -392,7 +394,7 @@ static void sc18_wr_wr(sc18is600_t * sc18, sc18_hook_t hook)
 
     // next steps up to limit are for sending the buffer
     if ( sc18->step > SC18_TX_BUF_SIZE ) {
-        printf(YELLOW_COLOR"SC18"NORMAL_COLOR": write after write: too many data %d\n", sc18->step);
+        TRACE(sc18->avr, TRC_SC18, TRC_ERROR, YELLOW_COLOR"SC18"NORMAL_COLOR": write after write: too many data %d\n", sc18->step);
     }
 }
 
@@ -400,7 +402,7 @@ static void sc18_wr_wr(sc18is600_t * sc18, sc18_hook_t hook)
 // SPI configuration
 static uint8_t sc18_conf(uint8_t value, sc18is600_t * sc18)
 {
-	printf(YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
 
 	switch (sc18->step) {
 	case 0:
@@ -411,22 +413,22 @@ static uint8_t sc18_conf(uint8_t value, sc18is600_t * sc18)
 		// which configuration?
 		switch (value) {
 		case SC18_SPI_CONF_LSB:
-			printf("SC18: conf LSB first ");
+			TRACE(sc18->avr, TRC_SC18, TRC_INFO, "SC18: conf LSB first\n");
 			break;
 
 		case SC18_SPI_CONF_MSB:
-			printf("SC18: conf MSB first ");
+			TRACE(sc18->avr, TRC_SC18, TRC_INFO, "SC18: conf MSB first\n");
 			break;
 
 		default:
-			printf("SC18: unknown conf 0x%02x ", value);
+			TRACE(sc18->avr, TRC_SC18, TRC_ERROR, "SC18: unknown conf 0x%02x\n", value);
 			break;
 		}
 
 		break;
 
 	default:
-		printf("SC18: conf invalid step %02d ", sc18->step);
+		TRACE(sc18->avr, TRC_SC18, TRC_ERROR, "SC18: conf invalid step %02d\n", sc18->step);
 		break;
 	}
 
@@ -440,28 +442,28 @@ static uint8_t sc18_wr_reg(uint8_t value, sc18is600_t * sc18)
 	switch (sc18->step) {
 	case 0:
 		// command is received
-		printf("%s", __func__);
+		TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "%s", __func__);
 		break;
 
 	case 1:
 		// register offset is received
 		if ( /*value < SC18_REGS_OFFSET_MIN &&*/ value > SC18_REGS_OFFSET_MAX ) {
-			printf("invalid offset %d ", value);
+			TRACE(sc18->avr, TRC_SC18, TRC_ERROR, "invalid offset %d\n", value);
 		}
 		else {
 			sc18->reg_offset = value;
-			printf("  %s ", reg_name[value]);
+			TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "  %s ", reg_name[value]);
 		}
 		break;
 
 	case 2:
-		printf("    0x%02x   ", value);
+		TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "    0x%02x   ", value);
 		// register value is received
 		*((uint8_t*)&sc18->regs + sc18->reg_offset) = value;
 		break;
 
 	default:
-		printf("SC18: wr_reg invalid step %02d ", sc18->step);
+		TRACE(sc18->avr, TRC_SC18, TRC_ERROR, "SC18: wr_reg invalid step %02d\n", sc18->step);
 		break;
 	}
 
@@ -472,7 +474,7 @@ static uint8_t sc18_wr_reg(uint8_t value, sc18is600_t * sc18)
 // power-down mode
 static uint8_t sc18_pwr(uint8_t value, sc18is600_t * sc18)
 {
-	printf(YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
 
 	// sequence 0x30 0x5a 0xa5
 	switch (sc18->step) {
@@ -482,18 +484,18 @@ static uint8_t sc18_pwr(uint8_t value, sc18is600_t * sc18)
 
 	case 1:
 		if ( value != SC18_PWR_STEP_1 ) {
-			printf("invalid power-down step #1 0x%02x ", value);
+			TRACE(sc18->avr, TRC_SC18, TRC_ERROR, "invalid power-down step #1 0x%02x\n", value);
 		}
 		break;
 
 	case 2:
 		if ( value != SC18_PWR_STEP_2 ) {
-			printf("invalid power-down step #2 0x%02x ", value);
+			TRACE(sc18->avr, TRC_SC18, TRC_ERROR, "invalid power-down step #2 0x%02x\n", value);
 		}
 		break;
 
 	default:
-		printf("power-down invalid sequence %d ", sc18->step);
+		TRACE(sc18->avr, TRC_SC18, TRC_ERROR, "power-down invalid sequence %d\n", sc18->step);
 		break;
 	}
 
@@ -507,29 +509,29 @@ static uint8_t sc18_rd_reg(uint8_t value, sc18is600_t * sc18)
 	switch (sc18->step) {
 	case 0:
 		// command is received
-		printf("%s", __func__);
+		TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "%s", __func__);
 		break;
 
 	case 1:
 		// register offset is received
 		if ( /*value < SC18_REGS_OFFSET_MIN &&*/ value > SC18_REGS_OFFSET_MAX ) {
-			printf(" invalid offset %d", value);
+			TRACE(sc18->avr, TRC_SC18, TRC_ERROR, " invalid offset %d\n", value);
 		}
 		else {
 			sc18->reg_offset = value;
-			printf("  %s ", reg_name[value]);
+			TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "  %s ", reg_name[value]);
 		}
 		break;
 
 	case 2:
 		value = *((uint8_t*)&sc18->regs + sc18->reg_offset);
-		printf("    0x%02x   ", value);
+		TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "    0x%02x   ", value);
 		// register value is sent
 		return value;
 		break;
 
 	default:
-		printf(" invalid step %02d", sc18->step);
+		TRACE(sc18->avr, TRC_SC18, TRC_ERROR, " invalid step %02d\n", sc18->step);
 		break;
 	}
 
@@ -545,7 +547,7 @@ static void sc18_spi_hook(struct avr_irq_t * irq, uint32_t value, void * param)
 	uint8_t resp;
 	sc18is600_t * sc18 = (sc18is600_t*)param;
 
-	printf(YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
 
 	// check if chip is selected
 	if ( sc18->cs == 1 ) {
@@ -554,7 +556,7 @@ static void sc18_spi_hook(struct avr_irq_t * irq, uint32_t value, void * param)
 	}
 
     // new char received
-    printf("\t0x%02x --> rx| ", value);
+    TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, "\t0x%02x --> rx| ", value);
 
 	if ( sc18->step == 0 ) {
 		sc18->cmd = value;
@@ -563,13 +565,13 @@ static void sc18_spi_hook(struct avr_irq_t * irq, uint32_t value, void * param)
 	// which command?
 	switch (sc18->cmd) {
 	case SC18_WR_N:
-		printf(" wr n       ");
+		TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, " wr n       ");
         sc18->tx_buf[sc18->step] = value & 0xff;
 		resp = 0xff;
 		break;
 
 	case SC18_RD_N:
-		printf(" rd n       ");
+		TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, " rd n       ");
         sc18->tx_buf[sc18->step] = value & 0xff;
 		resp = 0xff;
 		break;
@@ -613,7 +615,7 @@ static void sc18_spi_hook(struct avr_irq_t * irq, uint32_t value, void * param)
 
 	// send response
     avr_raise_irq(sc18->spi_irq + SC18_SPI_IRQ_OUT, resp);
-    printf(" |tx --> 0x%02x\n", resp);
+    TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, " |tx --> 0x%02x\n", resp);
 }
 
 // called on every change on CS pin
@@ -623,7 +625,7 @@ static void sc18_spi_cs_hook(struct avr_irq_t * irq, uint32_t value, void * para
 
 	sc18is600_t * sc18 = (sc18is600_t*)param;
 
-	printf(YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
 
 	sc18->cs = value & SC18_CS_PB0;
 
@@ -668,7 +670,7 @@ static void sc18_spi_cs_hook(struct avr_irq_t * irq, uint32_t value, void * para
 
         default:
             sc18->fini = 1;
-            printf("unknown command 0x%02x\n", sc18->cmd);
+            TRACE(sc18->avr, TRC_SC18, TRC_ERROR, "unknown command 0x%02x\n", sc18->cmd);
             break;
         }
     }
@@ -682,7 +684,7 @@ static void sc18_i2c_hook(struct avr_irq_t * irq, uint32_t value, void * param)
 
 	sc18is600_t * sc18 = (sc18is600_t*)param;
 
-	printf(YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
+	TRACE(sc18->avr, TRC_SC18, TRC_DEBUG, YELLOW_COLOR"SC18"NORMAL_COLOR": ["YELLOW_COLOR"%s"NORMAL_COLOR"] %s CS:%d st:%d\n", sc18->avr->tag_name, __func__, sc18->cs, sc18->step);
 
     // continue the requested I2C transaction
     switch (sc18->cmd) {
@@ -711,7 +713,7 @@ static void sc18_i2c_hook(struct avr_irq_t * irq, uint32_t value, void * param)
         break;
 
     default:
-        printf("unknown command 0x%02x ", sc18->cmd);
+        TRACE(sc18->avr, TRC_SC18, TRC_ERROR, "unknown command 0x%02x\n", sc18->cmd);
         break;
     }
 }
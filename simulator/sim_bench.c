@@ -0,0 +1,335 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sc18is600.h"
+#include "mpu6050.h"
+#include "bench/bench.h"
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+
+
+// runner of the benchmark image (see bench/bench.c)
+//
+// it reports the cycles per call of each benchmark,
+// the flash and RAM footprint of the flight firmware,
+// and compares them to a baseline when one is given.
+
+
+// ------------------------------------------
+// private definitions
+//
+
+#define DEFAULT_THRESHOLD	5		// tolerated increase over the baseline [%]
+#define MAX_CYCLES			(60 * 16000000ULL)	// the run shall end well before
+
+
+// ------------------------------------------
+// private types
+//
+
+// cycles per call of a benchmark
+typedef struct {
+	unsigned int calls;
+	uint64_t min;
+	uint64_t max;
+	uint64_t sum;
+} stat_t;
+
+
+// ------------------------------------------
+// private variables
+//
+
+static const char* names[BCH_NB] = {
+	[BCH_EMPTY]			= "empty",
+	[BCH_INV_SQRT]		= "inv_sqrt",
+	[BCH_MADGWICK]		= "TKF_Madgwick",
+	[BCH_TKF_COMPUTE]	= "TKF_compute",
+	[BCH_SRV_DRIVE]		= "SRV_drive",
+	[BCH_SRV_TICK]		= "SRV_tick",
+	[BCH_STM_EVENT]		= "STM_event",
+	[BCH_STM_RUN]		= "STM_run",
+	[BCH_MPU_ITER]		= "MPU_thread",
+};
+
+static struct {
+	uint8_t id;					// benchmark in progress, 0 if none
+	avr_cycle_count_t start;	// cycle of its last start or resume
+	uint64_t sum;				// cycles of the call in progress
+	unsigned int marks;			// start/stop pairs of the call in progress
+	int end;
+
+	stat_t stat[BCH_NB];
+} bench;
+
+static struct {
+	uint32_t flash;
+	uint32_t ram;
+} footprint;
+
+
+// ------------------------------------------
+// private functions
+//
+
+static void usage(const char* name)
+{
+	fprintf(stderr, "usage: %s [-b baseline] [-t threshold%%] [-w baseline] bench.elf [minut.elf]\n", name);
+	fprintf(stderr, "\t-b : compare to the baseline, exit 1 on a regression\n");
+	fprintf(stderr, "\t-t : tolerated increase over the baseline (default %d %%)\n", DEFAULT_THRESHOLD);
+	fprintf(stderr, "\t-w : write the results as the new baseline\n");
+	exit(2);
+}
+
+
+// called on each write to the marker register
+static void bench_marker(struct avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param)
+{
+	(void)param;
+
+	avr->data[addr] = v;
+
+	// the running measure is suspended by any marker
+	if (bench.id) {
+		bench.sum += avr->cycle - bench.start;
+		bench.marks++;
+	}
+
+	switch (v) {
+	case BCH_STOP:
+		if (bench.id) {
+			stat_t* s = &bench.stat[bench.id];
+			uint64_t cost = bench.sum;
+
+			// remove the marker cost of each start/stop pair,
+			// the empty benchmark runs first to measure it
+			if (bench.id != BCH_EMPTY && bench.stat[BCH_EMPTY].calls) {
+				uint64_t overhead = bench.marks * bench.stat[BCH_EMPTY].min;
+				cost = cost > overhead ? cost - overhead : 0;
+			}
+
+			s->calls++;
+			s->sum += cost;
+			if (s->calls == 1 || cost < s->min)
+				s->min = cost;
+			if (cost > s->max)
+				s->max = cost;
+		}
+		bench.id = 0;
+		bench.sum = 0;
+		bench.marks = 0;
+		break;
+
+	case BCH_PAUSE:
+		break;
+
+	case BCH_END:
+		bench.end = 1;
+		break;
+
+	default:
+		if (v < BCH_NB) {
+			bench.id = v;
+			bench.start = avr->cycle;
+		}
+		else {
+			fprintf(stderr, "unknown benchmark marker 0x%02x\n", v);
+		}
+		break;
+	}
+}
+
+
+static avr_t* bench_setup(const char* fname)
+{
+	elf_firmware_t f;
+	avr_t* avr;
+
+	memset(&f, 0, sizeof(f));
+	if (elf_read_firmware(fname, &f)) {
+		fprintf(stderr, "can't load %s\n", fname);
+		exit(2);
+	}
+
+	avr = avr_make_mcu_by_name(f.mmcu);
+	if (!avr) {
+		fprintf(stderr, "AVR '%s' not known\n", f.mmcu);
+		exit(2);
+	}
+	avr_init(avr);
+	avr_load_firmware(avr, &f);
+	avr->log = 0;
+
+	avr_register_io_write(avr, BCH_MARKER_ADDR, bench_marker, NULL);
+
+	return avr;
+}
+
+
+static void footprint_read(const char* fname)
+{
+	elf_firmware_t f;
+
+	memset(&f, 0, sizeof(f));
+	if (elf_read_firmware(fname, &f)) {
+		fprintf(stderr, "can't load %s\n", fname);
+		exit(2);
+	}
+
+	// the initialized data are stored in flash too
+	footprint.flash = f.flashsize;
+	footprint.ram = f.datasize + f.bsssize;
+}
+
+
+static double average(int id)
+{
+	return bench.stat[id].calls ? (double)bench.stat[id].sum / bench.stat[id].calls : 0.0;
+}
+
+
+static void report(void)
+{
+	printf("%-16s %6s %8s %10s %8s\n", "bench", "calls", "min", "avg", "max");
+	for (int i = BCH_EMPTY + 1; i < BCH_NB; i++) {
+		printf("%-16s %6u %8llu %10.1f %8llu\n", names[i], bench.stat[i].calls,
+				(unsigned long long)bench.stat[i].min, average(i), (unsigned long long)bench.stat[i].max);
+	}
+
+	if (footprint.flash)
+		printf("\nflash %u bytes, ram %u bytes\n", footprint.flash, footprint.ram);
+}
+
+
+static void baseline_write(const char* fname)
+{
+	FILE* f = fopen(fname, "w");
+
+	if (!f) {
+		perror(fname);
+		exit(2);
+	}
+
+	fprintf(f, "# name avg-cycles\n");
+	for (int i = BCH_EMPTY + 1; i < BCH_NB; i++)
+		fprintf(f, "%s %.1f\n", names[i], average(i));
+	if (footprint.flash) {
+		fprintf(f, "flash %u\n", footprint.flash);
+		fprintf(f, "ram %u\n", footprint.ram);
+	}
+
+	fclose(f);
+}
+
+
+// return the number of regressions beyond the threshold
+static int baseline_compare(const char* fname, int threshold)
+{
+	char line[128];
+	char name[64];
+	double ref;
+	double val;
+	int fails = 0;
+	FILE* f = fopen(fname, "r");
+
+	if (!f) {
+		perror(fname);
+		exit(2);
+	}
+
+	printf("\n%-16s %10s %10s %8s\n", "baseline", "ref", "now", "diff");
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || sscanf(line, "%63s %lf", name, &ref) != 2)
+			continue;
+
+		val = -1;
+		if (0 == strcmp(name, "flash"))
+			val = footprint.flash;
+		else if (0 == strcmp(name, "ram"))
+			val = footprint.ram;
+		else
+			for (int i = BCH_EMPTY + 1; i < BCH_NB; i++)
+				if (0 == strcmp(name, names[i]))
+					val = average(i);
+
+		// footprint not measured or benchmark removed
+		if (val <= 0)
+			continue;
+
+		double diff = ref ? 100.0 * (val - ref) / ref : 0.0;
+		int ko = diff > threshold;
+
+		printf("%-16s %10.1f %10.1f %+7.1f%%%s\n", name, ref, val, diff, ko ? "  REGRESSION" : "");
+		fails += ko;
+	}
+
+	fclose(f);
+
+	return fails;
+}
+
+
+// ------------------------------------------
+// main
+//
+
+int main(int argc, char* argv[])
+{
+	const char* ref = NULL;
+	const char* out = NULL;
+	int threshold = DEFAULT_THRESHOLD;
+	int i;
+	int state;
+
+	for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+		if (i + 1 >= argc)
+			usage(argv[0]);
+
+		if (0 == strcmp(argv[i], "-b"))
+			ref = argv[++i];
+		else if (0 == strcmp(argv[i], "-t"))
+			threshold = atoi(argv[++i]);
+		else if (0 == strcmp(argv[i], "-w"))
+			out = argv[++i];
+		else
+			usage(argv[0]);
+	}
+	if (i >= argc)
+		usage(argv[0]);
+
+	avr_t* avr = bench_setup(argv[i]);
+	if (i + 1 < argc)
+		footprint_read(argv[i + 1]);
+
+	// the MPU thread runs against the bridge and MPU models
+	struct sc18is600_t* sc18 = sc18is600_alloc(avr);
+	mpu6050_alloc(avr, 0x68, sc18);
+
+	while (!bench.end) {
+		state = avr_run(avr);
+		if (state == cpu_Done || state == cpu_Crashed) {
+			fprintf(stderr, "benchmark image stopped before its end\n");
+			return 2;
+		}
+		if (avr->cycle > MAX_CYCLES) {
+			fprintf(stderr, "benchmark image doesn't end\n");
+			return 2;
+		}
+	}
+	avr_terminate(avr);
+
+	report();
+
+	if (out)
+		baseline_write(out);
+
+	if (ref && baseline_compare(ref, threshold)) {
+		printf("\nregression beyond %d %%\n", threshold);
+		return 1;
+	}
+
+	return 0;
+}
@@ -1,34 +1,410 @@
+#define _POSIX_C_SOURCE 199309L	// clock_gettime()
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 #include "sc18is600.h"
 #include "mpu6050.h"
+#include "cosim.h"
+#include "trace.h"
+#include "../soft/mark.h"
 
 #include "sim_avr.h"
 #include "avr_twi.h"
 #include "sim_elf.h"
 #include "sim_gdb.h"
 #include "sim_vcd_file.h"
+#include "sim_io.h"
+#include "avr_ioport.h"
+
+
+// the cores run by quantum of cycles before being synchronized,
+// a quantum of 0 keeps them in lockstep, one instruction each in turn
+#define DEFAULT_QUANTUM		1600	// 100 us @ 16 MHz
+
+#define DEFAULT_DURATION	20		// [s] simulated
+#define DISPLAY_PERIOD		1		// [s] simulated, between 2 progress lines
+
+// only the failures are printed
+static int quiet;
+
+
+// scenario assertions
+//
+// given on the command line and checked at the end of the run :
+//	state=N			the firmware signaled the state N (FR_STATE_xxx value)
+//	deploy=min:max	the cone servo was driven open between min and max [s]
+//	frame=N			a frame of command N was sent through a pool fifo
+// the states and frames are seen through the firmware markers (see soft/mark.h).
+// a failed assertion makes the simulation exit with 1.
+
+#define ASR_MAX			16
+
+typedef enum {
+	ASR_STATE,
+	ASR_DEPLOY,
+	ASR_FRAME,
+} asr_type_t;
+
+typedef struct {
+	asr_type_t type;
+	const char* arg;		// as given, for the report
+	unsigned int value;		// state or command
+	double min;				// [s]
+	double max;				// [s]
+} asr_t;
+
+static struct {
+	asr_t list[ASR_MAX];
+	int nb;
+
+	// first cycle each state or command was seen at, 0 if never
+	avr_cycle_count_t state[0x100];
+	avr_cycle_count_t frame[0x100];
+} asr;
+
+
+static void asr_state(uint8_t state, avr_cycle_count_t cycle)
+{
+	if (!asr.state[state])
+		asr.state[state] = cycle ? cycle : 1;
+}
+
+
+// called on each write of the frame marker
+static void asr_frame(struct avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param)
+{
+	(void)param;
+
+	avr->data[addr] = v;
+
+	if (!asr.frame[v])
+		asr.frame[v] = avr->cycle ? avr->cycle : 1;
+}
+
+
+// add an assertion given as kind=value
+static int asr_parse(const char* arg)
+{
+	asr_t* a = &asr.list[asr.nb];
+	char* end;
+
+	if (asr.nb >= ASR_MAX) {
+		fprintf(stderr, "too many assertions\n");
+		return -1;
+	}
+	a->arg = arg;
+
+	if (0 == strncmp(arg, "state=", strlen("state="))) {
+		a->type = ASR_STATE;
+		a->value = strtoul(arg + strlen("state="), &end, 0);
+	}
+	else if (0 == strncmp(arg, "frame=", strlen("frame="))) {
+		a->type = ASR_FRAME;
+		a->value = strtoul(arg + strlen("frame="), &end, 0);
+	}
+	else if (0 == strncmp(arg, "deploy=", strlen("deploy="))) {
+		a->type = ASR_DEPLOY;
+		a->min = strtod(arg + strlen("deploy="), &end);
+		if (*end != ':') {
+			fprintf(stderr, "deploy window expected as min:max in '%s'\n", arg);
+			return -1;
+		}
+		a->max = strtod(end + 1, &end);
+	}
+	else {
+		fprintf(stderr, "unknown assertion '%s'\n", arg);
+		return -1;
+	}
+
+	if (*end != '\0' || a->value > 0xff) {
+		fprintf(stderr, "bad value in assertion '%s'\n", arg);
+		return -1;
+	}
+
+	asr.nb++;
+
+	return 0;
+}
+
+
+static void asr_setup(avr_t* avr)
+{
+	avr_register_io_write(avr, MRK_FRM_ADDR, asr_frame, NULL);
+}
+
+
+// print the result of each assertion and return the number of failures
+// deploy is the cycle the cone servo was driven open at, 0 if never
+// in quiet mode, only the failures are printed
+static int asr_report(avr_t* avr, avr_cycle_count_t deploy)
+{
+	int fails = 0;
+
+	if (asr.nb && !quiet)
+		printf("\n%-20s %12s %s\n", "assertion", "at [s]", "result");
+
+	for (int i = 0; i < asr.nb; i++) {
+		const asr_t* a = &asr.list[i];
+		avr_cycle_count_t cycle = 0;
+		int ok;
+
+		switch (a->type) {
+		case ASR_STATE:
+			cycle = asr.state[a->value];
+			ok = cycle != 0;
+			break;
+
+		case ASR_FRAME:
+			cycle = asr.frame[a->value];
+			ok = cycle != 0;
+			break;
+
+		case ASR_DEPLOY:
+		default:
+			cycle = deploy;
+			ok = cycle != 0
+					&& 1. * cycle / avr->frequency >= a->min
+					&& 1. * cycle / avr->frequency <= a->max;
+			break;
+		}
+
+		fails += !ok;
+		if (quiet && ok)
+			continue;
+
+		if (cycle)
+			printf("%-20s %12.4f %s\n", a->arg, 1. * cycle / avr->frequency, ok ? "ok" : "FAILED");
+		else
+			printf("%-20s %12s %s\n", a->arg, "-", "FAILED");
+	}
+
+	return fails;
+}
+
+
+// deployment latency
+//
+// the chain is timed from the acceleration step of the MPU profile
+// through the firmware markers (see soft/mark.h) to the cone compare
+// value (OCR1A) and the first PB1 pulse with the new width.
+// a stage over its budget makes the simulation exit with 1.
+
+#define OCR1AL_ADDR		0x88
+#define OCR1AH_ADDR		0x89
+
+#define TMR1_PRESCALER	8		// cycles per TIMER1 tick
+#define PULSE_TOLERANCE	2		// [TIMER1 tick]
+
+typedef enum {
+	EV_STEP,
+	EV_TAKE_OFF,
+	EV_FLIGHT,
+	EV_DECISION,
+	EV_CONE_OPEN,
+	EV_OCR1A,
+	EV_PB1,
+	EV_NB,
+} lat_event_t;
+
+typedef struct {
+	const char* name;
+	lat_event_t from;
+	lat_event_t to;
+	double budget;		// [ms], 0 for none
+} lat_stage_t;
+
+static lat_stage_t stages[] = {
+	{ "detection",	EV_STEP,		EV_TAKE_OFF,	0. },	// includes the threshold duration
+	{ "dispatch",	EV_TAKE_OFF,	EV_FLIGHT,		20. },
+	{ "flight",		EV_FLIGHT,		EV_DECISION,	0. },	// the configured open time
+	{ "command",	EV_DECISION,	EV_CONE_OPEN,	20. },
+	{ "compare",	EV_CONE_OPEN,	EV_OCR1A,		25. },	// applied on the next PWM period
+	{ "output",		EV_OCR1A,		EV_PB1,			25. },
+	{ "total",		EV_STEP,		EV_PB1,			0. },
+};
+
+static struct {
+	avr_cycle_count_t cycle[EV_NB];
+	uint8_t seen[EV_NB];
+
+	uint16_t ocr1a;				// compare value when the cone is driven open
+	avr_cycle_count_t rise;		// last PB1 rising edge
+} lat;
+
+
+static void lat_event(lat_event_t ev, avr_cycle_count_t cycle)
+{
+	if (!lat.seen[ev]) {
+		lat.seen[ev] = 1;
+		lat.cycle[ev] = cycle;
+	}
+}
+
+
+static uint16_t lat_ocr1a(avr_t* avr)
+{
+	return avr->data[OCR1AL_ADDR] | (avr->data[OCR1AH_ADDR] << 8);
+}
+
+
+// called on each write of a firmware marker
+static void lat_marker(struct avr_t* avr, avr_io_addr_t addr, uint8_t v, void* param)
+{
+	(void)param;
+
+	avr->data[addr] = v;
+
+	switch (v) {
+	case MRK_TAKE_OFF:
+		lat_event(EV_TAKE_OFF, avr->cycle);
+		break;
+
+	case MRK_FLIGHT:
+		lat_event(EV_FLIGHT, avr->cycle);
+		break;
+
+	case MRK_DECISION:
+		lat_event(EV_DECISION, avr->cycle);
+		break;
+
+	case MRK_CONE_OPEN:
+		if (!lat.seen[EV_CONE_OPEN])
+			lat.ocr1a = lat_ocr1a(avr);
+		lat_event(EV_CONE_OPEN, avr->cycle);
+		break;
+
+	default:
+		if (v >= MRK_STATE)
+			asr_state(v - MRK_STATE, avr->cycle);
+		break;
+	}
+}
+
+
+// called on each change of the cone servo pin
+static void lat_pb1(struct avr_irq_t* irq, uint32_t value, void* param)
+{
+	avr_t* avr = param;
+	uint32_t width;
+
+	(void)irq;
+
+	if (value) {
+		lat.rise = avr->cycle;
+		return;
+	}
+
+	// the first pulse following the new compare value
+	if (lat.seen[EV_OCR1A] && !lat.seen[EV_PB1] && lat.rise > lat.cycle[EV_OCR1A]) {
+		width = (avr->cycle - lat.rise) / TMR1_PRESCALER;
+		if (abs((int)width - (int)lat_ocr1a(avr)) <= PULSE_TOLERANCE)
+			lat_event(EV_PB1, avr->cycle);
+	}
+}
+
+
+// the compare value is polled, its register being handled by the timer
+static void lat_poll(avr_t* avr)
+{
+	if (lat.seen[EV_CONE_OPEN] && !lat.seen[EV_OCR1A] && lat_ocr1a(avr) != lat.ocr1a)
+		lat_event(EV_OCR1A, avr->cycle);
+}
+
+
+static void lat_setup(avr_t* avr)
+{
+	float step = mpu6050_step_date();
+
+	if (step >= 0.)
+		lat_event(EV_STEP, step * avr->frequency);
+
+	avr_register_io_write(avr, MRK_ADDR, lat_marker, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 1), lat_pb1, avr);
+}
+
+
+// override a stage budget given as name=ms
+static int lat_budget(const char* arg)
+{
+	for (unsigned int i = 0; i < sizeof(stages) / sizeof(stages[0]); i++) {
+		size_t len = strlen(stages[i].name);
+
+		if (0 == strncmp(arg, stages[i].name, len) && arg[len] == '=') {
+			stages[i].budget = atof(arg + len + 1);
+			return 0;
+		}
+	}
+
+	fprintf(stderr, "unknown latency stage in '%s'\n", arg);
+	return -1;
+}
+
+
+// print the breakdown and return the number of stages over budget or not reached
+// in quiet mode, only the failing stages are printed
+static int lat_report(avr_t* avr)
+{
+	int fails = 0;
+
+	if (!quiet)
+		printf("\n%-10s %12s %12s %10s\n", "stage", "from [s]", "latency [ms]", "budget");
+	for (unsigned int i = 0; i < sizeof(stages) / sizeof(stages[0]); i++) {
+		const lat_stage_t* st = &stages[i];
+		double ms = 0.;
+		int reached = lat.seen[st->from] && lat.seen[st->to];
+		int ok;
+
+		if (reached) {
+			ms = 1000. * (lat.cycle[st->to] - lat.cycle[st->from]) / avr->frequency;
+			ok = st->budget == 0. || ms <= st->budget;
+		}
+		else {
+			ok = st->budget == 0.;
+		}
+
+		fails += !ok;
+		if (quiet && ok)
+			continue;
+
+		if (reached)
+			printf("%-10s %12.4f %12.3f", st->name, 1. * lat.cycle[st->from] / avr->frequency, ms);
+		else
+			printf("%-10s %12s %12s", st->name, "-", "not reached");
+
+		if (st->budget != 0.)
+			printf(" %10.1f%s", st->budget, ok ? "" : "  OVER BUDGET");
+		printf("\n");
+	}
+
+	return fails;
+}
 
 
-static avr_t* avr_setup(const char* fname, char* vcd_filename, int gdb, int gdb_port)
+static avr_t* avr_setup(const char* fname, const char* vcd_filename, int gdb, int gdb_port)
 {
-	printf("loading %s...\n", fname);
+	if (!quiet)
+		printf("loading %s...\n", fname);
 
 	elf_firmware_t f;
-	elf_read_firmware(fname, &f);
-	printf("firmware %s f=%d mmcu=%s\n", fname, (int)f.frequency, f.mmcu);
+	if (elf_read_firmware(fname, &f)) {
+		fprintf(stderr, "unable to load firmware '%s'\n", fname);
+		exit(2);
+	}
+	if (!quiet)
+		printf("firmware %s f=%d mmcu=%s\n", fname, (int)f.frequency, f.mmcu);
 	strcpy(f.tracename, vcd_filename);
 
 	avr_t * avr = NULL;
 	avr = avr_make_mcu_by_name(f.mmcu);
 	if (!avr) {
 		fprintf(stderr, "AVR '%s' not known\n", f.mmcu);
-		exit(1);
+		exit(2);
 	}
 	strcpy(avr->tag_name, fname);
-	avr->log = 3;
+	avr->log = trace_levels[TRC_AVR];
 	avr_init(avr);
 	avr_load_firmware(avr, &f);
 
@@ -37,27 +413,122 @@ static avr_t* avr_setup(const char* fname, char* vcd_filename, int gdb, int gdb_
 		avr->state = cpu_Stopped;
 	}
 	avr_gdb_init(avr);
-	avr->log = 3;
+	avr->log = trace_levels[TRC_AVR];
 
 	return avr;
 }
 
 
+typedef struct {
+	avr_cycle_count_t display;	// cycle of the next progress line
+	avr_cycle_count_t end;		// cycle the simulation stops at
+} sim_run_t;
+
+
+// called by the co-simulation between 2 quanta
+static int sim_sync(avr_cycle_count_t common, void* param)
+{
+	sim_run_t* run = param;
+
+	// no core is running
+	trace_flush();
+
+	// refresh common cycle display
+	if ( common >= run->display ) {
+		if (!quiet)
+			printf("cycle = %10ld (%9.1f s)\n", (long)common, common / 16e6);
+		run->display += DISPLAY_PERIOD * 16e6;
+	}
+
+	return common >= run->end;
+}
+
+
 int main(int argc, char* argv[])
 {
 	int debug = 0;
+	int threaded = 0;
+	const char* firmware = "minut.elf";
+	const char* vcd = "minut.vcd";
+	const char* node_elf = NULL;
+	double duration = DEFAULT_DURATION;
+	int ret = 0;
+	avr_cycle_count_t quantum = DEFAULT_QUANTUM;
+	struct timespec wall_start;
+	struct timespec wall_end;
 
-	if (argc == 2 && 0 == strncmp(argv[1], "-d", strlen("-d"))) {
-		debug = 1;
+	for (int i = 1; i < argc; i++) {
+		if (0 == strncmp(argv[i], "-d", strlen("-d"))) {
+			debug = 1;
+		}
+		else if (0 == strcmp(argv[i], "-l") && i + 1 < argc) {
+			if (lat_budget(argv[++i]))
+				return 2;
+		}
+		else if (0 == strcmp(argv[i], "-q") && i + 1 < argc) {
+			quantum = strtoull(argv[++i], NULL, 0);
+		}
+		else if (0 == strcmp(argv[i], "-t")) {
+			threaded = 1;
+		}
+		else if (0 == strcmp(argv[i], "-n") && i + 1 < argc) {
+			node_elf = argv[++i];
+		}
+		else if (0 == strcmp(argv[i], "-T") && i + 1 < argc) {
+			if (trace_open(argv[++i]))
+				return 2;
+		}
+		else if (0 == strcmp(argv[i], "-v") && i + 1 < argc) {
+			if (trace_select(argv[++i]))
+				return 2;
+		}
+		else if (0 == strcmp(argv[i], "-f") && i + 1 < argc) {
+			firmware = argv[++i];
+		}
+		else if (0 == strcmp(argv[i], "-p") && i + 1 < argc) {
+			if (mpu6050_profile_load(argv[++i]))
+				return 2;
+		}
+		else if (0 == strcmp(argv[i], "-s") && i + 1 < argc) {
+			duration = atof(argv[++i]);
+		}
+		else if (0 == strcmp(argv[i], "-V") && i + 1 < argc) {
+			vcd = argv[++i];
+		}
+		else if (0 == strcmp(argv[i], "-Q")) {
+			quiet = 1;
+		}
+		else if (0 == strcmp(argv[i], "-a") && i + 1 < argc) {
+			if (asr_parse(argv[++i]))
+				return 2;
+		}
+		else {
+			fprintf(stderr, "usage: %s [-d] [-f firmware.elf] [-p profile] [-s seconds] [-Q] [-q cycles] [-t] [-n node.elf]\n", argv[0]);
+			fprintf(stderr, "\t\t[-V file.vcd] [-T trace] [-v comp=level,...] [-l stage=ms]... [-a assertion]...\n");
+			fprintf(stderr, "\t-f : flight firmware (default minut.elf)\n");
+			fprintf(stderr, "\t-p : MPU-6050 measure profile file (default the built-in one)\n");
+			fprintf(stderr, "\t-s : simulated duration [s] (default %d)\n", DEFAULT_DURATION);
+			fprintf(stderr, "\t-Q : quiet, only print the failures\n");
+			fprintf(stderr, "\t-q : cycles run by each core before synchronizing, 0 for lockstep (default %d)\n", DEFAULT_QUANTUM);
+			fprintf(stderr, "\t-t : run each core on its own thread\n");
+			fprintf(stderr, "\t-n : add a node (ground or telemetry) linked to the minuterie UART\n");
+			fprintf(stderr, "\t-V : VCD file of the flight firmware (default minut.vcd)\n");
+			fprintf(stderr, "\t-T : record the trace in a file, printed by trace_print\n");
+			fprintf(stderr, "\t-v : trace levels of avr (0-5), sc18 and mpu (0 none, 1 error, 2 info, 3 debug)\n");
+			fprintf(stderr, "\t-l : latency budget of a stage [ms]\n");
+			fprintf(stderr, "\t-a : state=N, frame=N (command) or deploy=min:max [s]\n");
+			fprintf(stderr, "exit code : 0 ok, 1 failure (core error, budget or assertion), 2 bad arguments\n");
+			return 2;
+		}
 	}
 
+	struct cosim_t* cs = cosim_alloc(quantum);
+
 	// set every core
-	avr_t* minut = avr_setup("minut.elf", "minut.vcd", debug, 7000);
+	avr_t* minut = avr_setup(firmware, vcd, debug, 7000);
 
-	// all cores are to be connected on I2C bus
-	avr_t* cores[] = {
-		minut,
-	};
+	// the compare value is polled at each instruction to keep its timing exact
+	cosim_add(cs, minut, lat_poll);
 
 	// connect minut to SC18IS600 bridge and bridge to MPU-6050
 	struct sc18is600_t* sc18;
@@ -65,51 +536,55 @@ int main(int argc, char* argv[])
 	sc18 = sc18is600_alloc(minut);
 	mpu6050_alloc(minut, 0x68, sc18);
 
-	printf( "\negere simulation launched\n");
+	// time the deployment chain and watch the frames
+	lat_setup(minut);
+	asr_setup(minut);
 
+	// the node and the minuterie talk through their UART
+	avr_t* node = NULL;
+	if (node_elf) {
+		node = avr_setup(node_elf, "node.vcd", debug, 7001);
+		cosim_add(cs, node, NULL);
+		cosim_link_uart(cs, minut, '0', node, '0');
+		cosim_link_uart(cs, node, '0', minut, '0');
+	}
 
-	avr_cycle_count_t common_cycle = 0;
-	avr_cycle_count_t min_cycle = 0;
-#define DISPLAY_THRESHOLD	20*16e6
-	avr_cycle_count_t common_cycle_display_trigger = DISPLAY_THRESHOLD;
-	int state;
-
-	while (1) {
-		// avr->cycle fields of all cores shall be kept as close as possible
-		for (unsigned int i = 0; i < sizeof(cores) / sizeof(cores[0]); i++) {
-			// if the core is in advance, don't run it
-			if (cores[i]->cycle > common_cycle)
-				continue;
+	if (!quiet)
+		printf( "\negere simulation launched\n");
 
-			// run the core for 1 cycle and check if in error
-			state = avr_run(cores[i]);
-			if ((state == cpu_Done) || (state == cpu_Crashed)) {
-				printf("core #%d exits on error!\nquitting\n", i);
-				goto exit;
-			}
-		}
+	sim_run_t run = {
+		.display = DISPLAY_PERIOD * 16e6,
+		.end = duration * minut->frequency,
+	};
 
-		// update common cycle
-		min_cycle = cores[0]->cycle;
-		for (unsigned int i = 1; i < sizeof(cores) / sizeof(cores[0]); i++) {
-			if (cores[i]->cycle < min_cycle) {
-				min_cycle = cores[i]->cycle;
-			}
-		}
-		if (min_cycle > common_cycle)
-			common_cycle = min_cycle;
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
 
-		// refresh common cycle display 
-		if ( common_cycle >= common_cycle_display_trigger) {
-			printf("cycle = %10ld (%9.1f s)\n", (long)common_cycle, common_cycle / 16e6);
-			common_cycle_display_trigger += DISPLAY_THRESHOLD;
-			goto exit;
-		}
+	int err = cosim_run(cs, threaded, sim_sync, &run);
+	if (err >= 0) {
+		printf("core #%d exits on error!\nquitting\n", err);
+		ret = 1;
 	}
 
-exit:
+	clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+	double wall = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+	double sim = 1. * minut->cycle / minut->frequency;
+	if (!quiet)
+		printf("\nsimulated %.3f s in %.3f s (speed x%.2f, quantum %lu cycles%s)\n",
+				sim, wall, wall > 0. ? sim / wall : 0., (unsigned long)quantum, threaded ? ", threaded" : "");
+
+	if (lat_report(minut))
+		ret = 1;
+
+	if (asr_report(minut, lat.seen[EV_CONE_OPEN] ? lat.cycle[EV_CONE_OPEN] : 0))
+		ret = 1;
+
 	// stop cleanly
-	for (unsigned int i = 0; i < sizeof(cores) / sizeof(cores[0]); i++) {
-		avr_terminate(cores[i]);
-	}
+	trace_close();
+	cosim_free(cs);
+	avr_terminate(minut);
+	if (node)
+		avr_terminate(node);
+
+	return ret;
 }
@@ -0,0 +1,303 @@
+//
+// low-overhead trace of the simulated components, see trace.h
+//
+
+#include "trace.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+
+//--------------------------------------------------------------------
+// private defines
+//
+
+#define RING_SIZE		(1 << 16)	// records, shall be a power of 2
+#define STR_MAX			1024		// distinct strings in a file
+
+
+//--------------------------------------------------------------------
+// private structure definitions
+//
+
+typedef struct {
+	avr_cycle_count_t cycle;
+	const char* fmt;
+	uint8_t comp;
+	uint8_t level;
+	uint8_t nargs;
+	uint64_t arg[TRC_ARGS_MAX];
+} trc_rec_t;
+
+
+//--------------------------------------------------------------------
+// private variables
+//
+
+static const char* comp_names[TRC_NB] = {
+	[TRC_AVR] = "avr",
+	[TRC_SC18] = "sc18",
+	[TRC_MPU] = "mpu",
+};
+
+static struct {
+	FILE* file;
+
+	// records are reserved by the cores threads, flushed while they wait
+	trc_rec_t ring[RING_SIZE];
+	unsigned int head;
+	unsigned int tail;
+
+	// strings already written to the file, their id is their index
+	const char* str[STR_MAX];
+	int str_nb;
+} trace;
+
+
+//--------------------------------------------------------------------
+// public variables
+//
+
+// by default, only the errors
+uint8_t trace_levels[TRC_NB] = {
+	[TRC_AVR] = 2,		// simavr LOG_ERROR
+	[TRC_SC18] = TRC_ERROR,
+	[TRC_MPU] = TRC_ERROR,
+};
+
+
+//--------------------------------------------------------------------
+// private functions
+//
+
+// id of a string in the file, written on its first use
+static uint16_t trace_str(const char* s)
+{
+	uint16_t len;
+
+	// the strings are constants or live as long as the simulation
+	// so they are known by their address
+	for (int i = 0; i < trace.str_nb; i++) {
+		if (trace.str[i] == s)
+			return i;
+	}
+
+	if (trace.str_nb >= STR_MAX) {
+		fprintf(stderr, "trace: too many strings\n");
+		return 0;
+	}
+
+	trace.str[trace.str_nb] = s;
+	len = strlen(s);
+
+	fputc('S', trace.file);
+	fwrite(&trace.str_nb, sizeof(uint16_t), 1, trace.file);
+	fwrite(&len, sizeof(len), 1, trace.file);
+	fwrite(s, 1, len, trace.file);
+
+	return trace.str_nb++;
+}
+
+
+static void trace_write(const trc_rec_t* rec)
+{
+	const char* p = rec->fmt;
+	const char* start;
+	uint16_t fmt_id = trace_str(rec->fmt);
+	uint64_t arg[TRC_ARGS_MAX];
+	char type;
+
+	// the string arguments are replaced by their id
+	for (int i = 0; i < rec->nargs; i++) {
+		p = trace_conv(p, &start, &type);
+		arg[i] = type == TRC_ARG_STR ? trace_str((const char*)(uintptr_t)rec->arg[i]) : rec->arg[i];
+	}
+
+	fputc('R', trace.file);
+	fwrite(&rec->cycle, sizeof(uint64_t), 1, trace.file);
+	fwrite(&rec->comp, 1, 1, trace.file);
+	fwrite(&rec->level, 1, 1, trace.file);
+	fwrite(&fmt_id, sizeof(fmt_id), 1, trace.file);
+	fwrite(&rec->nargs, 1, 1, trace.file);
+	fwrite(arg, sizeof(uint64_t), rec->nargs, trace.file);
+}
+
+
+//--------------------------------------------------------------------
+// public functions
+//
+
+const char* trace_conv(const char* fmt, const char** start, char* type)
+{
+	int longs;
+
+	while (1) {
+		fmt = strchr(fmt, '%');
+		if (!fmt)
+			return NULL;
+
+		if (fmt[1] != '%')
+			break;
+		fmt += 2;
+	}
+	*start = fmt++;
+
+	// flags, width, precision and length
+	longs = 0;
+	while (*fmt && strchr("-+ #0123456789.lhzjt", *fmt)) {
+		if (*fmt == 'l' || *fmt == 'z' || *fmt == 'j' || *fmt == 't')
+			longs++;
+		fmt++;
+	}
+
+	switch (*fmt) {
+	case 's':
+		*type = TRC_ARG_STR;
+		break;
+
+	case 'e':
+	case 'f':
+	case 'g':
+		*type = TRC_ARG_DOUBLE;
+		break;
+
+	default:
+		*type = longs ? TRC_ARG_LONG : TRC_ARG_INT;
+		break;
+	}
+
+	return *fmt ? fmt + 1 : fmt;
+}
+
+
+int trace_select(const char* sel)
+{
+	char name[16];
+	int level;
+	int n;
+
+	while (*sel) {
+		if (2 != sscanf(sel, "%15[^=]=%d%n", name, &level, &n))
+			return -1;
+
+		int i;
+		for (i = 0; i < TRC_NB; i++) {
+			if (0 == strcmp(name, comp_names[i])) {
+				trace_levels[i] = level;
+				break;
+			}
+		}
+		if (i == TRC_NB) {
+			fprintf(stderr, "unknown trace component '%s'\n", name);
+			return -1;
+		}
+
+		sel += n;
+		if (*sel == ',')
+			sel++;
+	}
+
+	return 0;
+}
+
+
+int trace_open(const char* fname)
+{
+	trace.file = fopen(fname, "wb");
+	if (!trace.file) {
+		perror(fname);
+		return -1;
+	}
+
+	fwrite(TRC_MAGIC, 1, strlen(TRC_MAGIC), trace.file);
+
+	return 0;
+}
+
+
+void trace_flush(void)
+{
+	unsigned int head = __atomic_load_n(&trace.head, __ATOMIC_ACQUIRE);
+	uint32_t lost;
+
+	if (!trace.file)
+		return;
+
+	// the oldest records were overwritten
+	if (head - trace.tail > RING_SIZE) {
+		lost = head - trace.tail - RING_SIZE;
+		fputc('L', trace.file);
+		fwrite(&lost, sizeof(lost), 1, trace.file);
+		trace.tail = head - RING_SIZE;
+	}
+
+	for (; trace.tail != head; trace.tail++)
+		trace_write(&trace.ring[trace.tail & (RING_SIZE - 1)]);
+}
+
+
+void trace_close(void)
+{
+	if (!trace.file)
+		return;
+
+	trace_flush();
+	fclose(trace.file);
+	trace.file = NULL;
+}
+
+
+void trace_put(avr_t* avr, trc_comp_t comp, trc_level_t level, const char* fmt, ...)
+{
+	va_list ap;
+
+	// printed as it comes
+	if (!trace.file || level == TRC_ERROR) {
+		va_start(ap, fmt);
+		vprintf(fmt, ap);
+		va_end(ap);
+
+		if (!trace.file)
+			return;
+	}
+
+	// else the arguments are only stored, the formatting is done offline
+	unsigned int idx = __atomic_fetch_add(&trace.head, 1, __ATOMIC_ACQ_REL);
+	trc_rec_t* rec = &trace.ring[idx & (RING_SIZE - 1)];
+	const char* p = fmt;
+	const char* start;
+	char type;
+	double d;
+
+	rec->cycle = avr ? avr->cycle : 0;
+	rec->fmt = fmt;
+	rec->comp = comp;
+	rec->level = level;
+	rec->nargs = 0;
+
+	va_start(ap, fmt);
+	while (rec->nargs < TRC_ARGS_MAX && NULL != (p = trace_conv(p, &start, &type))) {
+		switch (type) {
+		case TRC_ARG_STR:
+			rec->arg[rec->nargs] = (uintptr_t)va_arg(ap, const char*);
+			break;
+
+		case TRC_ARG_LONG:
+			rec->arg[rec->nargs] = va_arg(ap, long long);
+			break;
+
+		case TRC_ARG_DOUBLE:
+			d = va_arg(ap, double);
+			memcpy(&rec->arg[rec->nargs], &d, sizeof(d));
+			break;
+
+		default:
+			rec->arg[rec->nargs] = va_arg(ap, int);
+			break;
+		}
+		rec->nargs++;
+	}
+	va_end(ap);
+}
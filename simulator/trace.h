@@ -0,0 +1,89 @@
+//
+// low-overhead trace of the simulated components
+//
+// each component has its own level, selected at run time.
+// a trace point below the level of its component costs a single test.
+//
+// when a trace file is opened, the trace points are only recorded
+// (cycle, format and raw arguments) in a binary ring, flushed to the file
+// while no core runs, and formatted offline by trace_print.
+// else they are printed as they come.
+// the errors are always printed as they come.
+//
+// the level of the avr component is the simavr log level (0 none to 5 debug).
+
+#ifndef __TRACE_H__
+# define __TRACE_H__
+
+# include <stdint.h>
+
+# include "sim_avr.h"
+
+
+// comment the define below to compile the trace points out
+#define USE_TRACE
+
+typedef enum {
+	TRC_AVR,
+	TRC_SC18,
+	TRC_MPU,
+	TRC_NB,
+} trc_comp_t;
+
+typedef enum {
+	TRC_NONE,
+	TRC_ERROR,
+	TRC_INFO,
+	TRC_DEBUG,	// every byte
+} trc_level_t;
+
+#define TRC_ARGS_MAX	8
+
+// current level of each component
+extern uint8_t trace_levels[TRC_NB];
+
+
+// set component levels from a list such as "sc18=3,mpu=1"
+// returns -1 on a syntax error or an unknown component
+int trace_select(const char* sel);
+
+// record the trace points in a file rather than printing them
+int trace_open(const char* fname);
+
+// write the recorded trace points to the file
+// shall be called while no core runs
+void trace_flush(void);
+
+// flush and close the file
+void trace_close(void);
+
+// record or print a trace point
+void trace_put(avr_t* avr, trc_comp_t comp, trc_level_t level, const char* fmt, ...)
+		__attribute__((format(printf, 4, 5)));
+
+// trace file : "EGTR" then records starting with their type byte
+//	'S' : u16 id, u16 length, the characters of a string (format or %s argument)
+//	'R' : u64 cycle, u8 component, u8 level, u16 format id,
+//	      u8 argument count, u64 arguments (string id for %s)
+//	'L' : u32 count of trace points lost on a ring overflow
+// the values are in the host byte order
+#define TRC_MAGIC		"EGTR"
+
+// argument types of a printf conversion
+#define TRC_ARG_INT		'i'
+#define TRC_ARG_LONG	'l'
+#define TRC_ARG_DOUBLE	'f'
+#define TRC_ARG_STR		's'
+
+// find the next conversion of a printf format
+// returns the character following it and sets its type, or NULL at the end
+const char* trace_conv(const char* fmt, const char** start, char* type);
+
+#ifdef USE_TRACE
+# define TRACE(avr, comp, level, ...)	\
+	do { if (trace_levels[comp] >= (level)) trace_put((avr), (comp), (level), __VA_ARGS__); } while (0)
+#else
+# define TRACE(avr, comp, level, ...)	do { } while (0)
+#endif
+
+#endif	// __TRACE_H__
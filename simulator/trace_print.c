@@ -0,0 +1,216 @@
+//
+// offline printer of the trace files, see trace.h
+//
+// usage : trace_print [-c] trace_file
+//	-c : prefix each trace point with its cycle
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "trace.h"
+
+
+//--------------------------------------------------------------------
+// private defines
+//
+
+#define STR_MAX			1024
+#define CONV_MAX		32
+
+
+//--------------------------------------------------------------------
+// private variables
+//
+
+static char* str[STR_MAX];
+
+
+//--------------------------------------------------------------------
+// private functions
+//
+
+static int read_n(FILE* f, void* buf, size_t len)
+{
+	return fread(buf, 1, len, f) == len ? 0 : -1;
+}
+
+
+static int read_str(FILE* f)
+{
+	uint16_t id;
+	uint16_t len;
+
+	if (read_n(f, &id, sizeof(id)) || read_n(f, &len, sizeof(len)) || id >= STR_MAX)
+		return -1;
+
+	free(str[id]);
+	str[id] = malloc(len + 1);
+	if (read_n(f, str[id], len))
+		return -1;
+	str[id][len] = '\0';
+
+	return 0;
+}
+
+
+static const char* get_str(uint64_t id)
+{
+	if (id >= STR_MAX || !str[id])
+		return "?";
+	return str[id];
+}
+
+
+// print a format, one conversion at a time
+static void print_fmt(const char* fmt, const uint64_t* arg, int nargs)
+{
+	const char* p = fmt;
+	const char* start;
+	const char* end;
+	char conv[CONV_MAX];
+	char type;
+	double d;
+	int i = 0;
+
+	while (NULL != (end = trace_conv(p, &start, &type)) && i < nargs) {
+		// the text before the conversion, "%%" included
+		for (; p < start; p++) {
+			putchar(*p);
+			if (p[0] == '%' && p[1] == '%')
+				p++;
+		}
+
+		if (end - start >= CONV_MAX) {
+			fputs("?", stdout);
+			p = end;
+			i++;
+			continue;
+		}
+		memcpy(conv, start, end - start);
+		conv[end - start] = '\0';
+
+		switch (type) {
+		case TRC_ARG_STR:
+			printf(conv, get_str(arg[i]));
+			break;
+
+		case TRC_ARG_LONG:
+			printf(conv, (long long)arg[i]);
+			break;
+
+		case TRC_ARG_DOUBLE:
+			memcpy(&d, &arg[i], sizeof(d));
+			printf(conv, d);
+			break;
+
+		default:
+			printf(conv, (int)arg[i]);
+			break;
+		}
+
+		p = end;
+		i++;
+	}
+
+	// the text after the last conversion
+	for (; *p; p++) {
+		putchar(*p);
+		if (p[0] == '%' && p[1] == '%')
+			p++;
+	}
+}
+
+
+static void usage(const char* name)
+{
+	fprintf(stderr, "usage : %s [-c] trace_file\n", name);
+	fprintf(stderr, "\t-c : prefix each trace point with its cycle\n");
+}
+
+
+//--------------------------------------------------------------------
+// main
+//
+
+int main(int argc, char* argv[])
+{
+	const char* fname = NULL;
+	int cycles = 0;
+	char magic[4];
+	FILE* f;
+	int c;
+
+	for (int i = 1; i < argc; i++) {
+		if (0 == strcmp(argv[i], "-c"))
+			cycles = 1;
+		else if (argv[i][0] != '-' && !fname)
+			fname = argv[i];
+		else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (!fname) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	f = fopen(fname, "rb");
+	if (!f) {
+		perror(fname);
+		return 1;
+	}
+
+	if (read_n(f, magic, sizeof(magic)) || memcmp(magic, TRC_MAGIC, sizeof(magic))) {
+		fprintf(stderr, "%s: not a trace file\n", fname);
+		return 1;
+	}
+
+	while (EOF != (c = fgetc(f))) {
+		uint64_t cycle;
+		uint8_t comp;
+		uint8_t level;
+		uint16_t fmt;
+		uint8_t nargs;
+		uint64_t arg[TRC_ARGS_MAX];
+		uint32_t lost;
+
+		switch (c) {
+		case 'S':
+			if (read_str(f))
+				goto truncated;
+			break;
+
+		case 'R':
+			if (read_n(f, &cycle, sizeof(cycle)) || read_n(f, &comp, 1) || read_n(f, &level, 1)
+					|| read_n(f, &fmt, sizeof(fmt)) || read_n(f, &nargs, 1)
+					|| nargs > TRC_ARGS_MAX || read_n(f, arg, nargs * sizeof(uint64_t)))
+				goto truncated;
+			if (cycles)
+				printf("[%10llu] ", (unsigned long long)cycle);
+			print_fmt(get_str(fmt), arg, nargs);
+			break;
+
+		case 'L':
+			if (read_n(f, &lost, sizeof(lost)))
+				goto truncated;
+			printf("\n*** %u trace points lost ***\n", lost);
+			break;
+
+		default:
+			fprintf(stderr, "%s: bad record 0x%02x\n", fname, c);
+			return 1;
+		}
+	}
+
+	fclose(f);
+
+	return 0;
+
+truncated:
+	fprintf(stderr, "%s: truncated\n", fname);
+	return 1;
+}
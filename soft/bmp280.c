@@ -0,0 +1,325 @@
+#include "bmp280.h"
+
+#ifdef USE_BMP280
+
+#include "mpu6050.h"
+#include "sc18is600.h"
+#include "pool.h"
+
+#include "dispatcher.h"
+
+#include "utils/pt.h"
+#include "utils/fifo.h"
+#include "utils/time.h"
+
+
+// ------------------------------------------
+// private definitions
+//
+
+#define IN_FIFO_SIZE	1
+#define OUT_FIFO_SIZE	1
+
+#define BMP_I2C_ADDR	(0x76 >> 1)
+
+#define BMP280_CALIB		0x88	// 24 bytes of calibration, LSB first
+#define BMP280_ID			0xd0
+#define BMP280_CTRL_MEAS	0xf4
+#define BMP280_CONFIG		0xf5
+#define BMP280_PRESS_MSB	0xf7	// pressure then temperature, 20-bit MSB first
+
+#define BMP280_CHIP_ID		0x58
+
+// temperature x1, pressure x4 (about 0.04 hPa), forced mode
+#define BMP280_FORCED		0x2d
+// no IIR filter
+#define BMP280_NO_FILTER	0x00
+
+#define BMP_CONV_TIME	(14 * TIME_1_MSEC)	// max conversion time with the oversampling above
+#define BMP_PERIOD		(50 * TIME_1_MSEC)	// measure period
+#define BMP_BUS_TIME	(2 * TIME_1_MSEC)	// longest transaction on the bus, with margin
+#define BMP_PROBE_NB	5					// ID reads before giving up
+
+
+// ------------------------------------------
+// private variables
+//
+
+struct {
+	pt_t pt;					// pt for the measure thread
+	pt_t pt_out;				// pt for sending thread
+	pt_t pt_spawn;				// pt for spawned threads
+	pt_t pt_spawn_2;			// pt for spawned threads
+
+	dpt_interface_t interf;		// interface to the dispatcher
+
+	frame_t in_buf[IN_FIFO_SIZE];
+	fifo_t in_fifo;
+
+	pool_hdl_t out_buf[OUT_FIFO_SIZE];	// outgoing frames handles fifo
+	pool_fifo_t out_fifo;
+
+	u8 started;
+	u8 probes;					// ID reads done
+
+	u8 tx[2];
+	u8 rx[12];
+	u8 n;
+
+	u32 time_out;				// next measure start
+	u32 conv;					// end of the conversion
+
+	// calibration
+	u16 dig_T1;
+	s16 dig_T2;
+	s16 dig_T3;
+	u16 dig_P1;
+	s16 dig_P[8];				// dig_P2 to dig_P9
+
+	s32 t_fine;					// temperature shared with the pressure compensation
+} BMP;
+
+
+// ------------------------------------------
+// private functions
+//
+
+// read n registers from reg in BMP.rx
+// the transaction fits in a gap of the MPU acquisitions
+// BMP.n is 0 on error
+static PT_THREAD( BMP_read(pt_t* pt, u8 reg, u8 n) )
+{
+	PT_BEGIN(pt);
+
+	PT_WAIT_UNTIL(pt, MPU_bus_idle() >= BMP_BUS_TIME && OK == SC18IS600_lock());
+
+	BMP.tx[0] = reg;
+	BMP.n = 1;
+	PT_SPAWN(pt, &BMP.pt_spawn_2, SC18IS600_tx(&BMP.pt_spawn_2, BMP_I2C_ADDR, BMP.tx, &BMP.n));
+
+	// no read if the register index was not acknowledged
+	if ( BMP.n ) {
+		BMP.n = n;
+		PT_SPAWN(pt, &BMP.pt_spawn_2, SC18IS600_rx(&BMP.pt_spawn_2, BMP_I2C_ADDR, BMP.rx, &BMP.n));
+	}
+
+	// the bridge is released whatever the outcome
+	SC18IS600_unlock();
+
+	PT_END(pt);
+}
+
+
+// write a register
+// BMP.n is 0 on error
+static PT_THREAD( BMP_write(pt_t* pt, u8 reg, u8 val) )
+{
+	PT_BEGIN(pt);
+
+	PT_WAIT_UNTIL(pt, MPU_bus_idle() >= BMP_BUS_TIME && OK == SC18IS600_lock());
+
+	BMP.tx[0] = reg;
+	BMP.tx[1] = val;
+	BMP.n = 2;
+	PT_SPAWN(pt, &BMP.pt_spawn_2, SC18IS600_tx(&BMP.pt_spawn_2, BMP_I2C_ADDR, BMP.tx, &BMP.n));
+
+	SC18IS600_unlock();
+
+	PT_END(pt);
+}
+
+
+// 16-bit LSB first value at index i of BMP.rx
+static u16 BMP_le16(u8 i)
+{
+	return BMP.rx[i] | (BMP.rx[i + 1] << 8);
+}
+
+
+// 20-bit MSB first value at index i of BMP.rx
+static s32 BMP_be20(u8 i)
+{
+	return ((s32)BMP.rx[i] << 12) | ((s32)BMP.rx[i + 1] << 4) | (BMP.rx[i + 2] >> 4);
+}
+
+
+// compensated temperature [0.01 degC], from the BMP280 datasheet
+static s32 BMP_temperature(s32 adc_T)
+{
+	s32 var1;
+	s32 var2;
+
+	var1 = ((((adc_T >> 3) - ((s32)BMP.dig_T1 << 1))) * ((s32)BMP.dig_T2)) >> 11;
+	var2 = (((((adc_T >> 4) - ((s32)BMP.dig_T1)) * ((adc_T >> 4) - ((s32)BMP.dig_T1))) >> 12) * ((s32)BMP.dig_T3)) >> 14;
+	BMP.t_fine = var1 + var2;
+
+	return (BMP.t_fine * 5 + 128) >> 8;
+}
+
+
+// compensated pressure [Pa], 32-bit version from the BMP280 datasheet
+// shall be called after BMP_temperature()
+static u32 BMP_pressure(s32 adc_P)
+{
+	s32 var1;
+	s32 var2;
+	u32 p;
+
+	var1 = (BMP.t_fine >> 1) - 64000L;
+	var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * ((s32)BMP.dig_P[6 - 2]);
+	var2 = var2 + ((var1 * ((s32)BMP.dig_P[5 - 2])) << 1);
+	var2 = (var2 >> 2) + (((s32)BMP.dig_P[4 - 2]) << 16);
+	var1 = (((BMP.dig_P[3 - 2] * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) + ((((s32)BMP.dig_P[2 - 2]) * var1) >> 1)) >> 18;
+	var1 = ((32768L + var1) * ((s32)BMP.dig_P1)) >> 15;
+
+	// avoid a division by zero
+	if ( var1 == 0 ) {
+		return 0;
+	}
+
+	p = (((u32)(1048576L - adc_P)) - (var2 >> 12)) * 3125;
+	if ( p < 0x80000000UL ) {
+		p = (p << 1) / ((u32)var1);
+	}
+	else {
+		p = (p / (u32)var1) * 2;
+	}
+
+	var1 = (((s32)BMP.dig_P[9 - 2]) * ((s32)(((p >> 3) * (p >> 3)) >> 13))) >> 12;
+	var2 = (((s32)(p >> 2)) * ((s32)BMP.dig_P[8 - 2])) >> 13;
+
+	return (u32)((s32)p + ((var1 + var2 + BMP.dig_P[7 - 2]) >> 4));
+}
+
+
+static PT_THREAD( BMP_thread(pt_t* pt) )
+{
+	frame_t* out;
+	pool_hdl_t hdl;
+	u32 press;
+	s16 temp;
+	u8 i;
+
+	PT_BEGIN(pt);
+
+	// the bridge is set up by the MPU
+	PT_WAIT_UNTIL(pt, OK == MPU_ready());
+
+	// the barometer may be missing, then stop bothering the bus
+	if ( BMP.probes >= BMP_PROBE_NB ) {
+		PT_YIELD_WHILE(pt, OK);
+	}
+
+	// check the chip is there
+	PT_SPAWN(pt, &BMP.pt_spawn, BMP_read(&BMP.pt_spawn, BMP280_ID, 1));
+	if ( BMP.n == 0 || BMP.rx[0] != BMP280_CHIP_ID ) {
+		BMP.probes++;
+		PT_RESTART(pt);
+	}
+
+	// read the calibration in 2 parts to fit in the bridge buffer
+	// a failure counts as a failed probe
+	PT_SPAWN(pt, &BMP.pt_spawn, BMP_read(&BMP.pt_spawn, BMP280_CALIB, 12));
+	if ( BMP.n == 0 ) {
+		BMP.probes++;
+		PT_RESTART(pt);
+	}
+	BMP.dig_T1 = BMP_le16(0);
+	BMP.dig_T2 = BMP_le16(2);
+	BMP.dig_T3 = BMP_le16(4);
+	BMP.dig_P1 = BMP_le16(6);
+	BMP.dig_P[0] = BMP_le16(8);
+	BMP.dig_P[1] = BMP_le16(10);
+
+	PT_SPAWN(pt, &BMP.pt_spawn, BMP_read(&BMP.pt_spawn, BMP280_CALIB + 12, 12));
+	if ( BMP.n == 0 ) {
+		BMP.probes++;
+		PT_RESTART(pt);
+	}
+	for (i = 0; i < 6; i++) {
+		BMP.dig_P[2 + i] = BMP_le16(2 * i);
+	}
+
+	PT_SPAWN(pt, &BMP.pt_spawn, BMP_write(&BMP.pt_spawn, BMP280_CONFIG, BMP280_NO_FILTER));
+	if ( BMP.n == 0 ) {
+		BMP.probes++;
+		PT_RESTART(pt);
+	}
+
+	BMP.time_out = TIME_get();
+	while (1) {
+		PT_WAIT_UNTIL(pt, TIME_get() >= BMP.time_out);
+		BMP.time_out += BMP_PERIOD;
+
+		// start a conversion and wait for its end
+		PT_SPAWN(pt, &BMP.pt_spawn, BMP_write(&BMP.pt_spawn, BMP280_CTRL_MEAS, BMP280_FORCED));
+		BMP.conv = TIME_get() + BMP_CONV_TIME;
+		PT_WAIT_UNTIL(pt, TIME_get() >= BMP.conv);
+
+		PT_SPAWN(pt, &BMP.pt_spawn, BMP_read(&BMP.pt_spawn, BMP280_PRESS_MSB, 6));
+
+		// a lost measure is skipped
+		if ( BMP.n == 0 || ! BMP.started ) {
+			continue;
+		}
+
+		// the locals don't survive a wait, so the values are computed
+		// from the raw readings once the frame is reserved
+		PT_WAIT_UNTIL(pt, NULL != (out = POOL_reserve(&BMP.out_fifo, &hdl)));
+		temp = BMP_temperature(BMP_be20(3));
+		press = BMP_pressure(BMP_be20(0));
+		frame_set_6(out, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_DATA_PRESS, 6,
+				(press & 0xff000000) >> 24, (press & 0x00ff0000) >> 16, (press & 0x0000ff00) >> 8, (press & 0x000000ff) >> 0,
+				(temp & 0xff00) >> 8, (temp & 0x00ff) >> 0);
+		POOL_commit(&BMP.out_fifo, hdl);
+	}
+
+	PT_END(pt);
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void BMP_init(void)
+{
+	FIFO_init(&BMP.in_fifo, &BMP.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
+	POOL_fifo_init(&BMP.out_fifo, BMP.out_buf, OUT_FIFO_SIZE);
+	POOL_fifo_data(&BMP.out_fifo);
+
+	BMP.interf.channel = 15;
+	BMP.interf.cmde_mask = _CM(FR_APPLI_START);
+	BMP.interf.queue = &BMP.in_fifo;
+	DPT_register(&BMP.interf);
+
+	BMP.started = 0;
+	BMP.probes = 0;
+
+	PT_INIT(&BMP.pt);
+	PT_INIT(&BMP.pt_out);
+}
+
+
+void BMP_run(void)
+{
+	frame_t fr;
+
+	// the only command is the start signal
+	if ( OK == FIFO_get(&BMP.in_fifo, &fr) && ! fr.resp && fr.cmde == FR_APPLI_START ) {
+		BMP.started = 1;
+	}
+
+	(void)PT_SCHEDULE(BMP_thread(&BMP.pt));
+
+	// send outgoing frame(s) if any
+	(void)PT_SCHEDULE(POOL_send(&BMP.pt_out, &BMP.out_fifo, &BMP.interf));
+}
+
+
+u16 BMP_ram(void)
+{
+	return sizeof(BMP);
+}
+
+#endif	// USE_BMP280
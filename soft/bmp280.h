@@ -0,0 +1,44 @@
+#ifndef __BMP280_H__
+# define __BMP280_H__
+
+# include "type_def.h"
+
+
+// BMP280 barometer handling
+//
+// the BMP280 shares the SC18IS600 I2C bus with the MPU-6050
+// (so it needs USE_SC18IS600 in mpu6050.c).
+// each measure is started in forced mode then read once converted.
+// every bus transaction waits for a gap between 2 MPU acquisitions
+// long enough to hold it, so the MPU sampling is not delayed.
+//
+// the compensated data are published after the application start
+// in FR_DATA_PRESS frames :
+//	argv[0..3] : pressure [Pa], MSB first
+//	argv[4..5] : temperature [0.01 degC], MSB first
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// comment the define below to remove the barometer from the build
+#define USE_BMP280
+
+
+// ------------------------------------------
+// public functions
+//
+
+#ifdef USE_BMP280
+
+extern void BMP_init(void);
+
+extern void BMP_run(void);
+
+// static RAM used by the module
+extern u16 BMP_ram(void);
+
+#endif
+
+#endif	// __BMP280_H__
@@ -0,0 +1,52 @@
+#include "cfg.h"
+
+#include "avr/eeprom.h"
+#include "util/crc16.h"
+
+#include <stddef.h>		// offsetof()
+
+
+// ------------------------------------------
+// private variables
+//
+
+// generated in eeprom_frames.c, after the frames
+extern const cfg_t* const eeprom_cfg;
+
+static struct {
+	cfg_t cfg;			// copy of the record
+	u8 valid;			// version and CRC are right
+} CFG;
+
+
+// ------------------------------------------
+// public functions
+//
+
+void CFG_init(void)
+{
+	const u8* p = (const u8*)&CFG.cfg;
+	u16 crc = 0xffff;
+	u8 i;
+
+	// the whole record in a single EEPROM read
+	eeprom_read_block(&CFG.cfg, eeprom_cfg, sizeof(cfg_t));
+
+	for (i = 0; i < offsetof(cfg_t, crc); i++) {
+		crc = _crc16_update(crc, p[i]);
+	}
+
+	CFG.valid = ( CFG.cfg.version == CFG_VERSION && CFG.cfg.crc == crc );
+}
+
+
+const cfg_t* CFG_get(void)
+{
+	return CFG.valid ? &CFG.cfg : NULL;
+}
+
+
+u16 CFG_ram(void)
+{
+	return sizeof(CFG);
+}
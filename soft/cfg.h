@@ -0,0 +1,62 @@
+#ifndef __CFG_H__
+# define __CFG_H__
+
+# include "type_def.h"
+
+
+// boot configuration
+//
+// the configuration is a packed record generated in EEPROM
+// by gen_eeprom_frames.py from minut.py.
+// it is checked once at init (version and CRC) then each module
+// reads its own fields from its init function.
+// if the record is not valid, the modules keep their default values.
+//
+// the configuration frames remain for the runtime changes.
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// to be kept in line with gen_eeprom_frames.py
+#define CFG_VERSION		0x01
+
+// the fields order is the one of gen_eeprom_frames.py
+typedef struct {
+	u8 version;			// CFG_VERSION
+
+	s8 cone_open;		// cone servo open position [degree]
+	s8 cone_close;		// cone servo closed position [degree]
+	u8 cone_slew;		// cone servo slew rate [degree / 20 ms]
+	u8 cone_hold;		// cone servo hold time before auto-off [100 ms]
+
+	s8 aero_open;		// aero servo open position [degree]
+	s8 aero_close;		// aero servo closed position [degree]
+	u8 aero_slew;		// aero servo slew rate [degree / 20 ms]
+	u8 aero_hold;		// aero servo hold time before auto-off [100 ms]
+
+	u8 open_time;		// flight time before opening [0.1 s]
+
+	u8 thr_duration;	// take-off threshold duration
+	u8 acc_thr;			// take-off acceleration threshold [0.1 G]
+
+	u16 crc;			// CRC-16 (poly 0xa001, init 0xffff) of the previous bytes
+} cfg_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+// read and check the configuration record
+// shall be called before any other module init
+extern void CFG_init(void);
+
+// return the configuration or NULL if the record is not valid
+extern const cfg_t* CFG_get(void);
+
+// static RAM used by the module
+extern u16 CFG_ram(void);
+
+#endif	// __CFG_H__
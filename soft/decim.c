@@ -0,0 +1,91 @@
+#include "decim.h"
+
+
+// ------------------------------------------
+// private functions
+//
+
+// median of 3 values
+static s16 DCM_median3(s16 a, s16 b, s16 c)
+{
+	if ( a > b ) {
+		if ( b > c ) {
+			return b;
+		}
+
+		return a > c ? c : a;
+	}
+
+	if ( a > c ) {
+		return a;
+	}
+
+	return b > c ? c : b;
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void DCM_init(dcm_t* dcm, u8 ratio, u8 median)
+{
+	u8 i;
+
+	for (i = 0; i < DCM_AXES; i++) {
+		dcm->acc[i] = 0;
+	}
+
+	dcm->ratio = ratio ? ratio : 1;
+	dcm->nb = 0;
+	dcm->idx = 0;
+	dcm->filled = 0;
+	dcm->median = median;
+}
+
+
+u8 DCM_put(dcm_t* dcm, const s16 in[DCM_AXES], s16 out[DCM_AXES])
+{
+	s16 val;
+	u8 i;
+
+	// save the sample in the median window
+	for (i = 0; i < DCM_AXES; i++) {
+		dcm->win[dcm->idx][i] = in[i];
+	}
+	dcm->idx++;
+	if ( dcm->idx >= DCM_MEDIAN_LEN ) {
+		dcm->idx = 0;
+	}
+	if ( dcm->filled < DCM_MEDIAN_LEN ) {
+		dcm->filled++;
+	}
+
+	// integrate
+	for (i = 0; i < DCM_AXES; i++) {
+		// the median is only available once the window is full
+		if ( dcm->median && dcm->filled == DCM_MEDIAN_LEN ) {
+			val = DCM_median3(dcm->win[0][i], dcm->win[1][i], dcm->win[2][i]);
+		}
+		else {
+			val = in[i];
+		}
+
+		dcm->acc[i] += val;
+	}
+	dcm->nb++;
+
+	// not enough samples yet
+	if ( dcm->nb < dcm->ratio ) {
+		return KO;
+	}
+
+	// comb and decimate
+	for (i = 0; i < DCM_AXES; i++) {
+		out[i] = dcm->acc[i] / dcm->ratio;
+		dcm->acc[i] = 0;
+	}
+	dcm->nb = 0;
+
+	return OK;
+}
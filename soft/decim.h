@@ -0,0 +1,53 @@
+#ifndef __DECIM_H__
+# define __DECIM_H__
+
+# include "type_def.h"
+
+
+// decimation stage for 3-axis samples
+//
+// each incoming sample may first go through a median of the
+// last 3 samples, rejecting a single spike on any axis.
+// the samples are then summed over the decimation ratio and
+// their mean is output once every ratio samples :
+// a first order CIC, that is a moving average followed by a decimation.
+//
+// only integer computations are used.
+
+
+// ------------------------------------------
+// public definitions
+//
+
+#define DCM_AXES		3		// number of axes of a sample
+#define DCM_MEDIAN_LEN	3		// length of the median window
+
+
+// ------------------------------------------
+// public types
+//
+
+typedef struct {
+	s32 acc[DCM_AXES];					// accumulated samples
+	s16 win[DCM_MEDIAN_LEN][DCM_AXES];	// last samples for the median
+	u8 ratio;							// decimation ratio
+	u8 nb;								// number of accumulated samples
+	u8 idx;								// next slot in the median window
+	u8 filled;							// number of samples in the median window
+	u8 median;							// median enabled
+} dcm_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+// reset the stage with the given ratio (at least 1)
+// and enable the median spike rejection if median is not 0
+extern void DCM_init(dcm_t* dcm, u8 ratio, u8 median);
+
+// feed one sample
+// return OK and the decimated sample in out every ratio samples, KO else
+extern u8 DCM_put(dcm_t* dcm, const s16 in[DCM_AXES], s16 out[DCM_AXES]);
+
+#endif	// __DECIM_H__
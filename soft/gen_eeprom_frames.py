@@ -12,6 +12,13 @@
 # an container frame is used and the sequence is coded
 # elsewhere in EEPROM.
 #
+# the boot configuration is not replayed as frames
+# but stored as a packed record read directly by the modules (see cfg.h).
+#
+# the frames and the record are members of a single EEPROM object,
+# so the frames stay at address 0 whatever the linker order
+# and the record follows them at the address computed here.
+#
 
 import sys
 
@@ -21,6 +28,57 @@ from frame import Frame
 import minut
 
 
+# to be kept in line with cfg.h
+CFG_VERSION = 0x01
+
+# configuration fields in the record order : name, signed
+CFG_FIELDS = [
+	('cone_open', True),
+	('cone_close', True),
+	('cone_slew', False),
+	('cone_hold', False),
+	('aero_open', True),
+	('aero_close', True),
+	('aero_slew', False),
+	('aero_hold', False),
+	('open_time', False),
+	('thr_duration', False),
+	('acc_thr', False),
+]
+
+
+def crc16(data):
+	"""CRC-16 as computed by _crc16_update() from avr-libc, from 0xffff"""
+	crc = 0xffff
+	for b in data:
+		crc ^= b
+		for i in range(8):
+			if crc & 1:
+				crc = (crc >> 1) ^ 0xa001
+			else:
+				crc >>= 1
+	return crc
+
+
+def compute_config(module, fd):
+	"""write the packed configuration record of the given module"""
+	data = [CFG_VERSION]
+	for name, signed in CFG_FIELDS:
+		val = module.config[name]
+		if not (-128 <= val <= 127 if signed else 0 <= val <= 255):
+			raise Exception("configuration value %s out of range : %d" % (name, val))
+		data.append(val & 0xff)
+
+	fd.write("\t//-> %s configuration :\n" % module.__name__)
+	fd.write("\t//" + "".join(" 0x%02x" % b for b in data) + "\n")
+	fd.write('\t.cfg = {\n')
+	fd.write('\t\t.version = 0x%02x,\n' % CFG_VERSION)
+	for name, signed in CFG_FIELDS:
+		fd.write('\t\t.%s = %d,\n' % (name, module.config[name]))
+	fd.write('\t\t.crc = 0x%04x,\n' % crc16(data))
+	fd.write('\t},\n')
+
+
 def compute_EEPROM(module, fd):
 	"""compute the content of eeprom memmory for the given module"""
 	f = frame.frame()
@@ -30,7 +88,6 @@ def compute_EEPROM(module, fd):
 	mem_map_slot = []			# slots memory map
 	mem_map_ext = []			# extended zone memory map (starting at end of slots mem)
 
-	fd.write("//-> %s :\n" % module.__name__)
 	#print module.slots
 	if len(module.slots) != module.slots_nb:
 		raise Exception("slots number inconsistant between declaration and instantiation")
@@ -63,7 +120,15 @@ def compute_EEPROM(module, fd):
 	mem_map.extend(mem_map_slot)
 	mem_map.extend(mem_map_ext)
 
+	# declare the C struct, the configuration record follows the frames
+	fd.write('const struct {\n')
+	fd.write('\tframe_t frames[%d];\n' % len(mem_map))
+	fd.write('\tcfg_t cfg;\t\t\t// at 0x%04x\n' % (len(mem_map) * fr_size))
+	fd.write('} eeprom __attribute__ ((section (".eeprom"))) = {\n')
+
 	# fill the C struct
+	fd.write('\t.frames = {\n')
+	fd.write("\t//-> %s :\n" % module.__name__)
 	for i in range(len(mem_map)):
 		if i == module.slots_nb:
 			fd.write("\n\t//-- start of extended zone --\n")
@@ -88,6 +153,12 @@ def compute_EEPROM(module, fd):
 		fd.write('}\n')
 
 		fd.write('\t},\n')
+	fd.write('\t},\n')
+	fd.write('\n')
+
+	compute_config(module, fd)
+
+	fd.write('};\n')
 
 
 #----------------------------
@@ -95,11 +166,13 @@ def compute_EEPROM(module, fd):
 if __name__ == '__main__':
 	fd = open(sys.argv[1], 'w')
 	fd.write('#include "dispatcher.h"\n')
+	fd.write('#include "cfg.h"\n')
 	fd.write('\n')
-	fd.write('const frame_t eeprom_frames[] __attribute__ ((section (".eeprom")))= {\n')
 
 	compute_EEPROM(minut, fd)
 
-	fd.write('};')
+	fd.write('\n')
+	fd.write('// EEPROM address of the configuration record\n')
+	fd.write('const cfg_t* const eeprom_cfg = &eeprom.cfg;\n')
 	fd.close()
 
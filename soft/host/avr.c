@@ -0,0 +1,65 @@
+#include "avr/io.h"
+#include "avr/eeprom.h"
+
+#include <string.h>		// memcpy()
+
+
+// host stand-ins for the ATmega328P registers and EEPROM
+
+
+// ------------------------------------------
+// registers
+//
+
+volatile uint8_t DDRB;
+volatile uint8_t PORTB;
+volatile uint8_t PINB;
+volatile uint8_t DDRD;
+volatile uint8_t PORTD;
+volatile uint8_t PIND;
+
+volatile uint8_t EICRA;
+volatile uint8_t EIMSK;
+volatile uint8_t EIFR;
+
+volatile uint8_t SREG;
+volatile uint8_t MCUSR;
+volatile uint8_t SMCR;
+volatile uint8_t GPIOR0;
+volatile uint8_t GPIOR1;
+volatile uint8_t GPIOR2;
+
+volatile uint16_t TCNT1;
+volatile uint16_t OCR1A;
+volatile uint16_t OCR1B;
+volatile uint16_t ICR1;
+volatile uint8_t TIMSK1;
+volatile uint8_t TIFR1;
+
+volatile uint8_t UDR0;
+volatile uint8_t UCSR0A;
+volatile uint8_t UCSR0B;
+volatile uint8_t UCSR0C;
+volatile uint8_t UBRR0H;
+volatile uint8_t UBRR0L;
+
+volatile uint16_t EEAR;
+volatile uint8_t EEDR;
+volatile uint8_t EECR;
+
+
+// ------------------------------------------
+// EEPROM
+//
+
+// the EEPROM variables are plain variables
+void eeprom_read_block(void* dst, const void* src, size_t n)
+{
+	memcpy(dst, src, n);
+}
+
+
+uint8_t eeprom_read_byte(const uint8_t* addr)
+{
+	return *addr;
+}
@@ -0,0 +1,358 @@
+#include "host.h"
+
+#include "sc18is600_internals.h"
+
+#include "drivers/spi.h"
+#include "utils/time.h"
+
+#include "avr/io.h"
+
+#include <string.h>		// memset()
+
+
+// host model of the sensor bus
+//
+// the SPI transfers are decoded as SC18IS600 commands
+// and the I2C transactions are run on register models
+// of the MPU-6050 and of the BMP280.
+//
+// each SPI transfer lasts 8 us per byte (1 MHz)
+// and each I2C transaction 100 us per byte (97 kHz),
+// the bridge reports itself busy meanwhile.
+//
+// the IMU and barometer values are given by the driver,
+// which can also unplug the barometer.
+// a change of acceleration above the motion threshold
+// while the MPU is in cycle mode raises its INT pin (INT0).
+
+
+// ------------------------------------------
+// private definitions
+//
+
+// same addresses as the drivers
+#define BUS_MPU_ADDR	(0x68 >> 1)
+#define BUS_BMP_ADDR	(0x76 >> 1)
+
+#define BUS_SPI_BYTE	(8 * TIME_1_USEC)
+#define BUS_I2C_BYTE	(100 * TIME_1_USEC)
+
+#define BUS_BUF_SIZE	16
+
+// MPU-6050 registers
+#define MPU_MOT_THR		0x1f
+#define MPU_INT_ENABLE	0x38
+#define MPU_INT_STATUS	0x3a
+#define MPU_ACCEL_XOUT	0x3b
+#define MPU_GYRO_XOUT	0x43
+#define MPU_PWR_MGMT_1	0x6b
+#define MPU_WHO_AM_I	0x75
+
+#define MPU_SLEEP		0x40	// PWR_MGMT_1
+#define MPU_CYCLE		0x20	// PWR_MGMT_1
+#define MPU_MOT_EN		0x40	// INT_ENABLE
+
+// BMP280 registers
+#define BMP_CALIB		0x88
+#define BMP_ID			0xd0
+#define BMP_PRESS_MSB	0xf7
+
+
+// ------------------------------------------
+// private variables
+//
+
+static struct {
+	u32 spi_end;				// end of the current SPI transfer
+	u32 i2c_end;				// end of the current I2C transaction
+
+	// bridge
+	u8 regs[sizeof(struct sc18is600_regs_t)];
+	i2c_stat_e_t stat;			// status of the last I2C transaction
+	u8 buf[BUS_BUF_SIZE];		// read buffer
+
+	struct {
+		u8 reg[128];
+		u8 ptr;
+		s16 acc[3];
+		s16 gyr[3];
+	} mpu;
+
+	struct {
+		u8 reg[256];
+		u8 ptr;
+		s32 adc_t;
+		s32 adc_p;
+		u8 absent;				// no acknowledge
+	} bmp;
+} BUS;
+
+
+// BMP280 calibration and raw data, from the datasheet example
+static const s32 BUS_bmp_calib[12] = {
+	27504, 26435, -1000,
+	36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000,
+};
+
+
+// the MPU INT pin wired to INT0
+extern void INT0_vect(void);
+
+
+// ------------------------------------------
+// private functions
+//
+
+static u8 BUS_mpu_read(u8 reg)
+{
+	s16 val;
+
+	if ( reg == MPU_INT_STATUS ) {
+		// a sample is always ready once awake
+		return BUS.mpu.reg[MPU_PWR_MGMT_1] & MPU_SLEEP ? 0x00 : 0x01;
+	}
+	else if ( reg >= MPU_ACCEL_XOUT && reg < MPU_ACCEL_XOUT + 6 ) {
+		val = BUS.mpu.acc[(reg - MPU_ACCEL_XOUT) / 2];
+	}
+	else if ( reg >= MPU_GYRO_XOUT && reg < MPU_GYRO_XOUT + 6 ) {
+		val = BUS.mpu.gyr[(reg - MPU_GYRO_XOUT) / 2];
+	}
+	else {
+		return BUS.mpu.reg[reg & 0x7f];
+	}
+
+	// MSB first
+	return (reg & 1) == (MPU_ACCEL_XOUT & 1) ? (val & 0xff00) >> 8 : (val & 0x00ff) >> 0;
+}
+
+
+static u8 BUS_bmp_read(u8 reg)
+{
+	switch ( reg ) {
+	case BMP_PRESS_MSB + 0:
+		return (BUS.bmp.adc_p >> 12) & 0xff;
+	case BMP_PRESS_MSB + 1:
+		return (BUS.bmp.adc_p >> 4) & 0xff;
+	case BMP_PRESS_MSB + 2:
+		return (BUS.bmp.adc_p << 4) & 0xf0;
+	case BMP_PRESS_MSB + 3:
+		return (BUS.bmp.adc_t >> 12) & 0xff;
+	case BMP_PRESS_MSB + 4:
+		return (BUS.bmp.adc_t >> 4) & 0xff;
+	case BMP_PRESS_MSB + 5:
+		return (BUS.bmp.adc_t << 4) & 0xf0;
+	default:
+		return BUS.bmp.reg[reg];
+	}
+}
+
+
+// I2C write : register pointer then data
+static i2c_stat_e_t BUS_i2c_write(u8 addr, const u8* data, u8 n)
+{
+	u8 i;
+
+	switch ( addr ) {
+	case BUS_MPU_ADDR:
+		BUS.mpu.ptr = data[0];
+		for (i = 1; i < n; i++) {
+			BUS.mpu.reg[BUS.mpu.ptr & 0x7f] = data[i];
+			BUS.mpu.ptr++;
+		}
+		return SC18_TR_SUCCESS;
+
+	case BUS_BMP_ADDR:
+		if ( BUS.bmp.absent ) {
+			return SC18_ADDR_NACK;
+		}
+		BUS.bmp.ptr = data[0];
+		for (i = 1; i < n; i++) {
+			BUS.bmp.reg[BUS.bmp.ptr] = data[i];
+			BUS.bmp.ptr++;
+		}
+		return SC18_TR_SUCCESS;
+
+	default:
+		return SC18_ADDR_NACK;
+	}
+}
+
+
+// I2C read from the register pointer
+static i2c_stat_e_t BUS_i2c_read(u8 addr, u8* data, u8 n)
+{
+	u8 i;
+
+	for (i = 0; i < n; i++) {
+		switch ( addr ) {
+		case BUS_MPU_ADDR:
+			data[i] = BUS_mpu_read(BUS.mpu.ptr);
+			BUS.mpu.ptr++;
+			break;
+
+		case BUS_BMP_ADDR:
+			if ( BUS.bmp.absent ) {
+				return SC18_ADDR_NACK;
+			}
+			data[i] = BUS_bmp_read(BUS.bmp.ptr);
+			BUS.bmp.ptr++;
+			break;
+
+		default:
+			return SC18_ADDR_NACK;
+		}
+	}
+
+	return SC18_TR_SUCCESS;
+}
+
+
+// value of the status register as seen by the driver
+static u8 BUS_stat(void)
+{
+	struct i2c_stat_t st;
+	u8 val = 0;
+
+	memset(&st, 0, sizeof(st));
+	st.stat = TIME_get() < BUS.i2c_end ? SC18_BUS_BUSY : BUS.stat;
+	// the driver reads the first byte
+	memcpy(&val, &st, 1);
+
+	return val;
+}
+
+
+// ------------------------------------------
+// SPI stand-in
+//
+
+void SPI_init(spi_mode_t mode, spi_pol_t pol, spi_order_t order, spi_div_t div)
+{
+	(void)mode;
+	(void)pol;
+	(void)order;
+	(void)div;
+}
+
+
+void SPI_master(u8* tx, u8 ntx, u8* rx, u8 nrx)
+{
+	u8 n;
+	u8 i;
+
+	BUS.spi_end = TIME_get() + (ntx > nrx ? ntx : nrx) * BUS_SPI_BYTE;
+
+	switch ( tx[0] ) {
+	case SC18_WR_I:
+		if ( tx[1] < sizeof(BUS.regs) ) {
+			BUS.regs[tx[1]] = tx[2];
+		}
+		break;
+
+	case SC18_RD_I:
+		if ( rx && nrx >= 3 ) {
+			rx[2] = tx[1] == offsetof(struct sc18is600_regs_t, i2c_stat) ? BUS_stat() : BUS.regs[tx[1] % sizeof(BUS.regs)];
+		}
+		break;
+
+	case SC18_WR_N:
+		n = tx[1];
+		BUS.stat = BUS_i2c_write(tx[2] >> 1, tx + 3, n);
+		BUS.i2c_end = BUS.spi_end + (n + 1) * BUS_I2C_BYTE;
+		break;
+
+	case SC18_RD_N:
+		n = tx[1] < BUS_BUF_SIZE ? tx[1] : BUS_BUF_SIZE;
+		BUS.stat = BUS_i2c_read(tx[2] >> 1, BUS.buf, n);
+		BUS.i2c_end = BUS.spi_end + (n + 1) * BUS_I2C_BYTE;
+		break;
+
+	case SC18_RD_BUF:
+		// the first byte is clocked out with the command
+		for (i = 1; i < nrx && i <= BUS_BUF_SIZE; i++) {
+			rx[i] = BUS.buf[i - 1];
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+u8 SPI_is_fini(void)
+{
+	return TIME_get() >= BUS.spi_end;
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void HST_bus_init(void)
+{
+	u8 i;
+
+	memset(&BUS, 0, sizeof(BUS));
+
+	// MPU-6050 reset values, at rest on the pad with X up (+-16G range)
+	BUS.mpu.reg[MPU_WHO_AM_I] = 0x68;
+	BUS.mpu.reg[MPU_PWR_MGMT_1] = MPU_SLEEP;
+	BUS.mpu.acc[0] = 2048;
+
+	// BMP280
+	BUS.bmp.reg[BMP_ID] = 0x58;
+	for (i = 0; i < 12; i++) {
+		BUS.bmp.reg[BMP_CALIB + 2 * i] = (BUS_bmp_calib[i] & 0x00ff) >> 0;
+		BUS.bmp.reg[BMP_CALIB + 2 * i + 1] = (BUS_bmp_calib[i] & 0xff00) >> 8;
+	}
+	BUS.bmp.adc_t = 519888;
+	BUS.bmp.adc_p = 415148;
+}
+
+
+void HST_bus_acc(s16 x, s16 y, s16 z)
+{
+	s16 val[3] = { x, y, z };
+	s32 thr = BUS.mpu.reg[MPU_MOT_THR] * 4;		// 2 mg per LSB, 2048 LSB/G
+	u8 motion = 0;
+	u8 i;
+
+	for (i = 0; i < 3; i++) {
+		s32 d = val[i] - BUS.mpu.acc[i];
+
+		if ( d > thr || d < -thr ) {
+			motion = 1;
+		}
+		BUS.mpu.acc[i] = val[i];
+	}
+
+	if ( motion
+			&& (BUS.mpu.reg[MPU_PWR_MGMT_1] & MPU_CYCLE)
+			&& (BUS.mpu.reg[MPU_INT_ENABLE] & MPU_MOT_EN)
+			&& (EIMSK & _BV(INT0)) ) {
+		INT0_vect();
+	}
+}
+
+
+void HST_bus_gyr(s16 x, s16 y, s16 z)
+{
+	BUS.mpu.gyr[0] = x;
+	BUS.mpu.gyr[1] = y;
+	BUS.mpu.gyr[2] = z;
+}
+
+
+void HST_bus_baro(s32 adc_t, s32 adc_p)
+{
+	BUS.bmp.adc_t = adc_t;
+	BUS.bmp.adc_p = adc_p;
+}
+
+
+void HST_bus_bmp(u8 present)
+{
+	BUS.bmp.absent = ! present;
+}
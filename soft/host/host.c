@@ -0,0 +1,651 @@
+#include "host.h"
+
+#include "minut.h"
+#include "servo.h"
+#include "mpu6050.h"
+#include "tk-off.h"
+#include "bmp280.h"
+#include "pool.h"
+#include "cfg.h"
+
+#include "dispatcher.h"
+
+#include "utils/time.h"
+
+#include "avr/io.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// host driver of the flight modules
+//
+// usage : host [-v] scenario
+//
+// the scenario is played over the simulated time
+// then the process exits with 1 if any check failed.
+//
+// each line of a scenario holds a time [ms] then a command :
+//	cone open|closed			set the cone switch
+//	start						send the application start signal
+//	acc x y z					next accelerations [raw MPU counts, 2048 / G]
+//	gyr x y z					next rotations [raw MPU counts]
+//	baro adc_t adc_p			next barometer raw conversions
+//	bmp present|absent			plug or unplug the barometer
+//	samples file				play a stream of "ms ax ay az gx gy gz" lines
+//								from the command time on
+//	frame cmde a0 .. a5			send a frame on behalf of the ground
+//	expect until cmde a0 .. a5	a matching frame shall be sent before until [ms]
+//	reject until cmde a0 .. a5	no matching frame shall be sent before until [ms]
+//	pwm A|B min max				the servo compare value shall be in the range
+//	end							end of the run
+//
+// a command is given by its name (FR_xxx), a byte in C notation,
+// '-' matches any byte of the sent frame.
+// '#' starts a comment.
+
+
+// ------------------------------------------
+// private definitions
+//
+
+#define HST_STEP		(100 * TIME_1_USEC)		// superloop pass duration
+#define HST_TMR1_PERIOD	(20 * TIME_1_MSEC)		// servo PWM period
+#define HST_END_MARGIN	(1 * TIME_1_SEC)		// run duration after the last event
+
+#define HST_EVENT_NB	4096
+#define HST_LINE_SIZE	256
+#define HST_ANY			0x100					// wildcard byte
+
+#define HST_NAME(n)		{ #n, n }
+
+
+// ------------------------------------------
+// private types
+//
+
+typedef enum {
+	HST_CONE,
+	HST_START,
+	HST_ACC,
+	HST_GYR,
+	HST_BARO,
+	HST_BMP,
+	HST_FRAME,
+	HST_EXPECT,
+	HST_REJECT,
+	HST_PWM,
+	HST_END,
+} hst_cmd_t;
+
+typedef struct {
+	u32 time;					// [us]
+	u32 until;					// end of the check window [us]
+	hst_cmd_t cmd;
+	u16 cmde;
+	s32 val[DPT_ARGC];			// values or bytes (HST_ANY allowed)
+	u8 nb;						// number of bytes given
+
+	const char* file;			// origin for the reports
+	u32 line;
+
+	u8 active;					// check window open
+	u8 matched;					// a frame has matched
+} hst_event_t;
+
+
+// ------------------------------------------
+// private variables
+//
+
+static const struct {
+	const char* name;
+	u8 cmde;
+} HST_names[] = {
+	HST_NAME(FR_STATE),
+	HST_NAME(FR_LED_CMD),
+	HST_NAME(FR_APPLI_START),
+	HST_NAME(FR_TAKE_OFF),
+	HST_NAME(FR_TAKE_OFF_THRES),
+	HST_NAME(FR_DATA_ACC),
+	HST_NAME(FR_DATA_GYR),
+	HST_NAME(FR_DATA_PRESS),
+	HST_NAME(FR_MINUT_TIME_OUT),
+	HST_NAME(FR_MINUT_SERVO_CMD),
+	HST_NAME(FR_MINUT_SERVO_INFO),
+	HST_NAME(FR_MINUT_BATCH),
+	HST_NAME(FR_MINUT_LATENCY),
+};
+
+static struct {
+	hst_event_t ev[HST_EVENT_NB];
+	u32 nb;
+
+	u32 now;
+	u32 end;
+	u8 verbose;
+	u32 failures;
+	u32 checks;
+} HST;
+
+
+// the record gen_eeprom_frames.py builds from minut.py
+static const cfg_t HST_cfg = {
+	.version = CFG_VERSION,
+	.cone_open = -15,
+	.cone_close = 30,
+	.cone_slew = 0,
+	.cone_hold = 0,
+	.aero_open = -15,
+	.aero_close = 30,
+	.aero_slew = 0,
+	.aero_hold = 0,
+	.open_time = 45,
+	.thr_duration = 10,
+	.acc_thr = 30,
+	.crc = 0x8e0b,
+};
+
+const cfg_t* const eeprom_cfg = &HST_cfg;
+
+
+// ------------------------------------------
+// private functions
+//
+
+static const char* HST_cmde_name(u8 cmde)
+{
+	u8 i;
+
+	for (i = 0; i < sizeof(HST_names) / sizeof(HST_names[0]); i++) {
+		if ( HST_names[i].cmde == cmde ) {
+			return HST_names[i].name;
+		}
+	}
+
+	return "?";
+}
+
+
+static int HST_cmde_parse(const char* s)
+{
+	u8 i;
+
+	for (i = 0; i < sizeof(HST_names) / sizeof(HST_names[0]); i++) {
+		if ( 0 == strcmp(HST_names[i].name, s) ) {
+			return HST_names[i].cmde;
+		}
+	}
+
+	return -1;
+}
+
+
+static void HST_fail(hst_event_t* ev, const char* msg)
+{
+	fprintf(stderr, "%s:%u: %.1f ms: %s\n", ev->file, ev->line, HST.now / 1000.0, msg);
+	HST.failures++;
+}
+
+
+static hst_event_t* HST_new(const char* file, u32 line, u32 time)
+{
+	hst_event_t* ev;
+
+	if ( HST.nb >= HST_EVENT_NB ) {
+		fprintf(stderr, "%s:%u: too many events\n", file, line);
+		exit(2);
+	}
+
+	ev = &HST.ev[HST.nb];
+	HST.nb++;
+
+	memset(ev, 0, sizeof(*ev));
+	ev->file = file;
+	ev->line = line;
+	ev->time = time;
+
+	return ev;
+}
+
+
+// read the values following the command, return their number
+static u8 HST_values(hst_event_t* ev, u8 max, u8 bytes)
+{
+	char* tok;
+
+	ev->nb = 0;
+	while ( NULL != (tok = strtok(NULL, " \t\n")) ) {
+		if ( ev->nb >= max ) {
+			fprintf(stderr, "%s:%u: too many values\n", ev->file, ev->line);
+			exit(2);
+		}
+
+		if ( bytes && 0 == strcmp(tok, "-") ) {
+			ev->val[ev->nb] = HST_ANY;
+		}
+		else {
+			ev->val[ev->nb] = strtol(tok, NULL, 0);
+		}
+		ev->nb++;
+	}
+
+	return ev->nb;
+}
+
+
+static void HST_load(const char* file, u32 offset);
+
+
+static void HST_parse(const char* file, u32 line, char* buf, u32 offset)
+{
+	hst_event_t* ev;
+	char* tok;
+	char* cmd;
+	u32 time;
+	int cmde;
+
+	// strip the comment
+	if ( NULL != (tok = strchr(buf, '#')) ) {
+		*tok = '\0';
+	}
+
+	if ( NULL == (tok = strtok(buf, " \t\n")) ) {
+		return;
+	}
+	time = offset + strtoul(tok, NULL, 0) * TIME_1_MSEC;
+
+	if ( NULL == (cmd = strtok(NULL, " \t\n")) ) {
+		fprintf(stderr, "%s:%u: missing command\n", file, line);
+		exit(2);
+	}
+
+	if ( 0 == strcmp(cmd, "samples") ) {
+		HST_load(strtok(NULL, " \t\n"), time);
+		return;
+	}
+
+	ev = HST_new(file, line, time);
+
+	if ( 0 == strcmp(cmd, "cone") ) {
+		ev->cmd = HST_CONE;
+		tok = strtok(NULL, " \t\n");
+		ev->val[0] = tok && 0 == strcmp(tok, "open");
+	}
+	else if ( 0 == strcmp(cmd, "start") ) {
+		ev->cmd = HST_START;
+	}
+	else if ( 0 == strcmp(cmd, "acc") || 0 == strcmp(cmd, "gyr") ) {
+		ev->cmd = cmd[0] == 'a' ? HST_ACC : HST_GYR;
+		if ( 3 != HST_values(ev, 3, 0) ) {
+			fprintf(stderr, "%s:%u: 3 values expected\n", file, line);
+			exit(2);
+		}
+	}
+	else if ( 0 == strcmp(cmd, "baro") ) {
+		ev->cmd = HST_BARO;
+		if ( 2 != HST_values(ev, 2, 0) ) {
+			fprintf(stderr, "%s:%u: 2 values expected\n", file, line);
+			exit(2);
+		}
+	}
+	else if ( 0 == strcmp(cmd, "bmp") ) {
+		ev->cmd = HST_BMP;
+		tok = strtok(NULL, " \t\n");
+		ev->val[0] = ! tok || 0 != strcmp(tok, "absent");
+	}
+	else if ( 0 == strcmp(cmd, "frame") || 0 == strcmp(cmd, "expect") || 0 == strcmp(cmd, "reject") ) {
+		if ( cmd[0] == 'f' ) {
+			ev->cmd = HST_FRAME;
+		}
+		else {
+			ev->cmd = cmd[0] == 'e' ? HST_EXPECT : HST_REJECT;
+			tok = strtok(NULL, " \t\n");
+			ev->until = offset + (tok ? strtoul(tok, NULL, 0) : 0) * TIME_1_MSEC;
+		}
+
+		tok = strtok(NULL, " \t\n");
+		if ( ! tok || (cmde = HST_cmde_parse(tok)) < 0 ) {
+			fprintf(stderr, "%s:%u: unknown command %s\n", file, line, tok ? tok : "");
+			exit(2);
+		}
+		ev->cmde = cmde;
+		(void)HST_values(ev, DPT_ARGC, ev->cmd != HST_FRAME);
+	}
+	else if ( 0 == strcmp(cmd, "pwm") ) {
+		ev->cmd = HST_PWM;
+		tok = strtok(NULL, " \t\n");
+		ev->cmde = tok && tok[0] == 'B' ? TMR1_B : TMR1_A;
+		if ( 2 != HST_values(ev, 2, 0) ) {
+			fprintf(stderr, "%s:%u: min and max expected\n", file, line);
+			exit(2);
+		}
+	}
+	else if ( 0 == strcmp(cmd, "end") ) {
+		ev->cmd = HST_END;
+	}
+	else {
+		fprintf(stderr, "%s:%u: unknown command %s\n", file, line, cmd);
+		exit(2);
+	}
+}
+
+
+// a sample stream is a list of "ms ax ay az gx gy gz" lines
+static void HST_samples(const char* file, u32 line, char* buf, u32 offset)
+{
+	hst_event_t* acc;
+	hst_event_t* gyr;
+	char* tok;
+	u32 time;
+	u8 i;
+
+	if ( NULL != (tok = strchr(buf, '#')) ) {
+		*tok = '\0';
+	}
+
+	if ( NULL == (tok = strtok(buf, " \t\n,")) ) {
+		return;
+	}
+	time = offset + strtod(tok, NULL) * TIME_1_MSEC;
+
+	acc = HST_new(file, line, time);
+	acc->cmd = HST_ACC;
+	gyr = HST_new(file, line, time);
+	gyr->cmd = HST_GYR;
+
+	for (i = 0; i < 6; i++) {
+		if ( NULL == (tok = strtok(NULL, " \t\n,")) ) {
+			fprintf(stderr, "%s:%u: 6 values expected\n", file, line);
+			exit(2);
+		}
+
+		if ( i < 3 ) {
+			acc->val[i] = strtol(tok, NULL, 0);
+		}
+		else {
+			gyr->val[i - 3] = strtol(tok, NULL, 0);
+		}
+	}
+}
+
+
+// load a scenario (offset 0) or a sample stream
+static void HST_load(const char* file, u32 offset)
+{
+	char buf[HST_LINE_SIZE];
+	FILE* fd;
+	u32 line = 0;
+	const char* name;
+
+	if ( ! file || NULL == (fd = fopen(file, "r")) ) {
+		fprintf(stderr, "can't open %s\n", file ? file : "samples file");
+		exit(2);
+	}
+
+	// the name is kept for the reports
+	name = strdup(file);
+
+	while ( fgets(buf, sizeof(buf), fd) ) {
+		line++;
+
+		if ( offset ) {
+			HST_samples(name, line, buf, offset);
+		}
+		else {
+			HST_parse(name, line, buf, 0);
+		}
+	}
+
+	fclose(fd);
+}
+
+
+// keep the file order for the events at the same time
+static int HST_compare(const void* a, const void* b)
+{
+	const hst_event_t* ea = a;
+	const hst_event_t* eb = b;
+
+	if ( ea->time != eb->time ) {
+		return ea->time < eb->time ? -1 : 1;
+	}
+
+	return ea < eb ? -1 : ea > eb;
+}
+
+
+static u8 HST_match(const hst_event_t* ev, const frame_t* fr)
+{
+	u8 i;
+
+	if ( fr->cmde != ev->cmde ) {
+		return KO;
+	}
+
+	for (i = 0; i < ev->nb; i++) {
+		if ( ev->val[i] != HST_ANY && ev->val[i] != fr->argv[i] ) {
+			return KO;
+		}
+	}
+
+	return OK;
+}
+
+
+static void HST_spy(const dpt_interface_t* from, const frame_t* fr)
+{
+	u32 i;
+
+	if ( HST.verbose ) {
+		printf("%9.1f ms  %3s %-3d %-20s %s %02x %02x %02x %02x %02x %02x\n",
+				HST.now / 1000.0,
+				from ? "ch" : "gnd", from ? from->channel : 0,
+				HST_cmde_name(fr->cmde), fr->resp ? "resp" : "    ",
+				fr->argv[0], fr->argv[1], fr->argv[2], fr->argv[3], fr->argv[4], fr->argv[5]);
+	}
+
+	for (i = 0; i < HST.nb; i++) {
+		hst_event_t* ev = &HST.ev[i];
+
+		if ( ev->active && ! ev->matched && OK == HST_match(ev, fr) ) {
+			ev->matched = 1;
+		}
+	}
+}
+
+
+static void HST_play(hst_event_t* ev)
+{
+	frame_t fr;
+	u16 cmp;
+	char msg[HST_LINE_SIZE];
+
+	switch ( ev->cmd ) {
+	case HST_CONE:
+		// the switch is on PB3, high when open
+		if ( ev->val[0] ) {
+			PINB |= _BV(PB3);
+		}
+		else {
+			PINB &= ~_BV(PB3);
+		}
+		break;
+
+	case HST_START:
+		frame_set_0(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_APPLI_START, 0);
+		if ( OK != HST_dpt_inject(&fr) ) {
+			HST_fail(ev, "dispatcher full");
+		}
+		break;
+
+	case HST_ACC:
+		HST_bus_acc(ev->val[0], ev->val[1], ev->val[2]);
+		break;
+
+	case HST_GYR:
+		HST_bus_gyr(ev->val[0], ev->val[1], ev->val[2]);
+		break;
+
+	case HST_BARO:
+		HST_bus_baro(ev->val[0], ev->val[1]);
+		break;
+
+	case HST_BMP:
+		HST_bus_bmp(ev->val[0]);
+		break;
+
+	case HST_FRAME:
+		frame_set_6(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, ev->cmde, ev->nb,
+				ev->val[0], ev->val[1], ev->val[2], ev->val[3], ev->val[4], ev->val[5]);
+		if ( OK != HST_dpt_inject(&fr) ) {
+			HST_fail(ev, "dispatcher full");
+		}
+		break;
+
+	case HST_EXPECT:
+	case HST_REJECT:
+		ev->active = 1;
+		break;
+
+	case HST_PWM:
+		HST.checks++;
+		cmp = HST_tmr1_compare(ev->cmde);
+		if ( cmp < ev->val[0] || cmp > ev->val[1] ) {
+			snprintf(msg, sizeof(msg), "servo %c compare %u out of [%d; %d]",
+					ev->cmde == TMR1_A ? 'A' : 'B', cmp, ev->val[0], ev->val[1]);
+			HST_fail(ev, msg);
+		}
+		break;
+
+	case HST_END:
+		HST.end = HST.now;
+		break;
+	}
+}
+
+
+// close the check windows ending now
+static void HST_check(u8 all)
+{
+	u32 i;
+	char msg[HST_LINE_SIZE];
+
+	for (i = 0; i < HST.nb; i++) {
+		hst_event_t* ev = &HST.ev[i];
+
+		if ( ! ev->active || (! all && HST.now < ev->until) ) {
+			continue;
+		}
+		ev->active = 0;
+		HST.checks++;
+
+		if ( ev->cmd == HST_EXPECT && ! ev->matched ) {
+			snprintf(msg, sizeof(msg), "expected %s not sent", HST_cmde_name(ev->cmde));
+			HST_fail(ev, msg);
+		}
+
+		if ( ev->cmd == HST_REJECT && ev->matched ) {
+			snprintf(msg, sizeof(msg), "rejected %s sent", HST_cmde_name(ev->cmde));
+			HST_fail(ev, msg);
+		}
+	}
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+int main(int argc, char* argv[])
+{
+	u32 next = 0;
+	u32 tick = 0;
+	u32 i;
+
+	if ( argc == 3 && 0 == strcmp(argv[1], "-v") ) {
+		HST.verbose = 1;
+		argv++;
+		argc--;
+	}
+
+	if ( argc != 2 ) {
+		fprintf(stderr, "usage : %s [-v] scenario\n", argv[0]);
+		return 2;
+	}
+
+	HST_load(argv[1], 0);
+	qsort(HST.ev, HST.nb, sizeof(hst_event_t), HST_compare);
+
+	// the run lasts until the end command or a while after the last event
+	HST.end = TIME_MAX;
+	for (i = 0; i < HST.nb; i++) {
+		if ( HST.ev[i].cmd == HST_END ) {
+			HST.end = HST.ev[i].time;
+			break;
+		}
+	}
+	if ( HST.end == TIME_MAX ) {
+		HST.end = 0;
+		for (i = 0; i < HST.nb; i++) {
+			u32 t = HST.ev[i].until > HST.ev[i].time ? HST.ev[i].until : HST.ev[i].time;
+
+			if ( t + HST_END_MARGIN > HST.end ) {
+				HST.end = t + HST_END_MARGIN;
+			}
+		}
+	}
+
+	// same init sequence as main()
+	HST_bus_init();
+	HST_dpt_spy(HST_spy);
+
+	CFG_init();
+	if ( NULL == CFG_get() ) {
+		fprintf(stderr, "invalid boot configuration, the default values are used\n");
+	}
+	DPT_init();
+	POOL_init();
+
+	MNT_init();
+	SRV_init();
+	MPU_init();
+#ifdef USE_BMP280
+	BMP_init();
+#endif
+	TKF_init();
+
+	for ( HST.now = 0; HST.now < HST.end; HST.now += HST_STEP ) {
+		// scenario events
+		while ( next < HST.nb && HST.ev[next].time <= HST.now ) {
+			HST_play(&HST.ev[next]);
+			next++;
+		}
+
+		// servo PWM period
+		if ( HST.now >= tick ) {
+			tick += HST_TMR1_PERIOD;
+			HST_tmr1_overflow();
+		}
+
+		// superloop pass
+		DPT_run();
+		MNT_run();
+		SRV_run();
+		MPU_run();
+		TKF_run();
+#ifdef USE_BMP280
+		BMP_run();
+#endif
+
+		HST_check(0);
+		HST_time_step(HST_STEP);
+	}
+
+	HST_check(1);
+
+	printf("%s : %u checks, %u failures\n", argv[1], HST.checks, HST.failures);
+
+	return HST.failures ? 1 : 0;
+}
@@ -0,0 +1,64 @@
+#ifndef __HOST_H__
+# define __HOST_H__
+
+# include "type_def.h"
+# include "dispatcher.h"
+# include "drivers/timer1.h"
+
+
+// host build of the flight modules
+//
+// the nanoK and scalp services are replaced by in-process stand-ins :
+//	- nanok.c : fifo, time, state machine and timers,
+//	- scalp.c : dispatcher routing the frames by command,
+//	- avr.c : registers and EEPROM,
+//	- bus.c : SPI with the SC18IS600 bridge and its I2C devices.
+//
+// the simulated time only moves when the driver (host.c) says so.
+// the functions below are the hooks the driver uses to play a scenario.
+
+
+// ------------------------------------------
+// nanoK stand-ins
+//
+
+// move the simulated time forward [us]
+extern void HST_time_step(u32 dt);
+
+// run the TIMER1 overflow interrupt if enabled
+extern void HST_tmr1_overflow(void);
+
+// last value set for a TIMER1 compare unit
+extern u16 HST_tmr1_compare(tmr1_compare_t comp);
+
+
+// ------------------------------------------
+// scalp stand-ins
+//
+
+// send a frame on behalf of the ground
+// return OK if accepted
+extern u8 HST_dpt_inject(frame_t* fr);
+
+// called for every frame accepted by the dispatcher
+// from is NULL for the injected frames
+extern void HST_dpt_spy(void (*spy)(const dpt_interface_t* from, const frame_t* fr));
+
+
+// ------------------------------------------
+// bus model
+//
+
+extern void HST_bus_init(void);
+
+// set the next IMU samples [raw MPU-6050 counts]
+extern void HST_bus_acc(s16 x, s16 y, s16 z);
+extern void HST_bus_gyr(s16 x, s16 y, s16 z);
+
+// set the next barometer raw conversions
+extern void HST_bus_baro(s32 adc_t, s32 adc_p);
+
+// plug or unplug the barometer, an absent device doesn't acknowledge
+extern void HST_bus_bmp(u8 present);
+
+#endif	// __HOST_H__
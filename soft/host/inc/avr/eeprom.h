@@ -0,0 +1,13 @@
+#ifndef __AVR_EEPROM_H__
+# define __AVR_EEPROM_H__
+
+// host stand-in : the EEPROM is the plain memory
+
+# include <stddef.h>
+# include <stdint.h>
+
+extern void eeprom_read_block(void* dst, const void* src, size_t n);
+
+extern uint8_t eeprom_read_byte(const uint8_t* addr);
+
+#endif	// __AVR_EEPROM_H__
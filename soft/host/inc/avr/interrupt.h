@@ -0,0 +1,12 @@
+#ifndef __AVR_INTERRUPT_H__
+# define __AVR_INTERRUPT_H__
+
+// host stand-in : an interrupt handler is a plain function
+// the host loop calls it when the event occurs
+
+#define ISR(vector)		void vector(void); void vector(void)
+
+#define sei()
+#define cli()
+
+#endif	// __AVR_INTERRUPT_H__
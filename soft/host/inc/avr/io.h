@@ -0,0 +1,93 @@
+#ifndef __AVR_IO_H__
+# define __AVR_IO_H__
+
+// host stand-in for the ATmega328P registers
+// the registers are plain variables defined in avr.c
+
+# include <stdint.h>
+
+#define _BV(b)	(1 << (b))
+
+#define F_CPU	16000000UL
+
+// ports
+extern volatile uint8_t DDRB;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t PINB;
+extern volatile uint8_t DDRD;
+extern volatile uint8_t PORTD;
+extern volatile uint8_t PIND;
+
+// external interrupts
+extern volatile uint8_t EICRA;
+extern volatile uint8_t EIMSK;
+extern volatile uint8_t EIFR;
+
+// status and general purpose registers
+extern volatile uint8_t SREG;
+extern volatile uint8_t MCUSR;
+extern volatile uint8_t SMCR;
+extern volatile uint8_t GPIOR0;
+extern volatile uint8_t GPIOR1;
+extern volatile uint8_t GPIOR2;
+
+// TIMER1
+extern volatile uint16_t TCNT1;
+extern volatile uint16_t OCR1A;
+extern volatile uint16_t OCR1B;
+extern volatile uint16_t ICR1;
+extern volatile uint8_t TIMSK1;
+extern volatile uint8_t TIFR1;
+
+// USART0
+extern volatile uint8_t UDR0;
+extern volatile uint8_t UCSR0A;
+extern volatile uint8_t UCSR0B;
+extern volatile uint8_t UCSR0C;
+extern volatile uint8_t UBRR0H;
+extern volatile uint8_t UBRR0L;
+
+// EEPROM
+extern volatile uint16_t EEAR;
+extern volatile uint8_t EEDR;
+extern volatile uint8_t EECR;
+
+#define PB0		0
+#define PB1		1
+#define PB2		2
+#define PB3		3
+#define PB4		4
+#define PB5		5
+#define PD2		2
+#define PD3		3
+
+#define ISC00	0
+#define ISC01	1
+#define INT0	0
+#define INTF0	0
+
+#define TOV1	0
+#define TOIE1	0
+
+#define U2X0	1
+#define UCSZ00	1
+#define UCSZ01	2
+#define TXEN0	3
+#define RXEN0	4
+#define UDRIE0	5
+#define UDRE0	5
+
+#define EERE	0
+#define EEPE	1
+#define EEMPE	2
+#define EERIE	3
+
+#define EXTRF	1
+#define BORF	2
+#define WDRF	3
+
+#define RAMSTART	0x100
+#define RAMEND		0x8ff
+#define E2END		0x3ff
+
+#endif	// __AVR_IO_H__
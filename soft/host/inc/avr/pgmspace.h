@@ -0,0 +1,10 @@
+#ifndef __AVR_PGMSPACE_H__
+# define __AVR_PGMSPACE_H__
+
+// host stand-in : the program space is the plain memory
+
+#define PROGMEM
+
+#define pgm_read_byte(addr)	(*(const unsigned char*)(addr))
+
+#endif	// __AVR_PGMSPACE_H__
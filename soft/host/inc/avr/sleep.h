@@ -0,0 +1,11 @@
+#ifndef __AVR_SLEEP_H__
+# define __AVR_SLEEP_H__
+
+// host stand-in : sleeping is a no-op
+
+#define SLEEP_MODE_IDLE		0
+
+#define set_sleep_mode(mode)	(void)(mode)
+#define sleep_mode()
+
+#endif	// __AVR_SLEEP_H__
@@ -0,0 +1,136 @@
+#ifndef __DISPATCHER_H__
+# define __DISPATCHER_H__
+
+// host stand-in for the scalp dispatcher
+//
+// the command list holds the commands used by the flight modules,
+// only their names matter on the host, not their values.
+// the frames are routed in-process by their command (see scalp.c).
+
+# include "type_def.h"
+# include "utils/fifo.h"
+
+
+// ------------------------------------------
+// public definitions
+//
+
+#define DPT_SELF_ADDR	0x01
+#define DPT_ARGC		6
+
+typedef enum {
+	FR_NO_CMDE,
+	FR_I2C_READ,
+	FR_I2C_WRITE,
+	FR_EEP_READ,
+	FR_EEP_WRITE,
+	FR_CONTAINER,
+	FR_STATE,
+	FR_LED_CMD,
+	FR_APPLI_START,
+	FR_TAKE_OFF,
+	FR_TAKE_OFF_THRES,
+	FR_DATA_ACC,
+	FR_DATA_GYR,
+	FR_DATA_PRESS,
+	FR_MINUT_TIME_OUT,
+	FR_MINUT_SERVO_CMD,
+	FR_MINUT_SERVO_INFO,
+	FR_MINUT_PROFILE,
+	FR_MINUT_RAM,
+	FR_MINUT_BATCH,
+	FR_MINUT_LATENCY,
+	FR_MINUT_RECORD,
+	FR_MINUT_TELEMETRY,
+	FR_CMDE_NB
+} fr_cmdes_t;
+
+#define FR_STATE_SET	0x7a
+#define FR_STATE_GET	0x8b
+
+#define FR_STATE_INIT			0x00
+#define FR_STATE_CONE_OPENING	0x01
+#define FR_STATE_AERO_OPENING	0x02
+#define FR_STATE_AERO_OPEN		0x03
+#define FR_STATE_CONE_CLOSING	0x04
+#define FR_STATE_CONE_CLOSED	0x05
+#define FR_STATE_WAITING		0x06
+#define FR_STATE_FLIGHT			0x07
+#define FR_STATE_CONE_OPEN		0x08
+#define FR_STATE_BRAKING		0x09
+#define FR_STATE_PARACHUTE		0x0a
+
+#define FR_LED_ALIVE	0xa1
+#define FR_LED_OPEN		0x09
+#define FR_LED_SET		0x5e
+
+#define FR_SERVO_CONE	0xc0
+#define FR_SERVO_AERO	0xae
+#define FR_SERVO_SAVE	0x5a
+#define FR_SERVO_READ	0x4e
+#define FR_SERVO_OPEN	0x09
+#define FR_SERVO_CLOSE	0xc1
+#define FR_SERVO_OFF	0x0f
+#define FR_SERVO_SLEW	0x51
+#define FR_SERVO_HOLD	0x40
+
+#define FR_BATCH_KEEP	0xff
+
+
+// ------------------------------------------
+// public types
+//
+
+typedef struct {
+	u8 dest;
+	u8 orig;
+	u8 t_id;
+	u8 cmde;
+	union {
+		u8 status;
+		struct {
+			u8 len:3;
+			u8 :2;
+			u8 nat:1;
+			u8 error:1;
+			u8 resp:1;
+		};
+	};
+	u8 argv[DPT_ARGC];
+} frame_t;
+
+#define _CM(cmde)	((u64)1 << (cmde))
+
+typedef struct {
+	u8 channel;
+	u64 cmde_mask;
+	fifo_t* queue;
+} dpt_interface_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+extern void DPT_init(void);
+
+extern void DPT_run(void);
+
+extern void DPT_register(dpt_interface_t* interf);
+
+extern void DPT_lock(dpt_interface_t* interf);
+
+extern void DPT_unlock(dpt_interface_t* interf);
+
+// return OK if the frame is accepted
+extern u8 DPT_tx(dpt_interface_t* interf, frame_t* fr);
+
+extern u8 frame_set_0(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len);
+extern u8 frame_set_1(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0);
+extern u8 frame_set_2(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1);
+extern u8 frame_set_3(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1, u8 a2);
+extern u8 frame_set_4(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1, u8 a2, u8 a3);
+extern u8 frame_set_5(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1, u8 a2, u8 a3, u8 a4);
+extern u8 frame_set_6(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1, u8 a2, u8 a3, u8 a4, u8 a5);
+
+#endif	// __DISPATCHER_H__
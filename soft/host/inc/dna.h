@@ -0,0 +1,9 @@
+#ifndef __DNA_H__
+# define __DNA_H__
+
+// host stand-in for the scalp DNA
+// nothing of it is used by the flight modules
+
+# include "type_def.h"
+
+#endif	// __DNA_H__
@@ -0,0 +1,47 @@
+#ifndef __TIMER1_H__
+# define __TIMER1_H__
+
+// host stand-in for the nanoK TIMER1 driver
+// the overflow callback is called by the host loop
+
+# include "type_def.h"
+
+typedef enum {
+	TMR1_WITHOUT_INTERRUPT,
+	TMR1_WITH_OVERFLOW_INT,
+	TMR1_WITH_COMPARE_INT,
+} tmr1_int_t;
+
+typedef enum {
+	TMR1_PRESCALER_1,
+	TMR1_PRESCALER_8,
+	TMR1_PRESCALER_64,
+	TMR1_PRESCALER_256,
+	TMR1_PRESCALER_1024,
+} tmr1_prescaler_t;
+
+typedef enum {
+	TMR1_WGM_NORMAL,
+	TMR1_WGM_FAST_PWM_ICR1,
+} tmr1_wgm_t;
+
+typedef enum {
+	COM1AB_0000,
+	COM1AB_1010,
+} tmr1_com_t;
+
+typedef enum {
+	TMR1_A,
+	TMR1_B,
+	TMR1_CAPT,
+} tmr1_compare_t;
+
+extern void TMR1_init(tmr1_int_t it, tmr1_prescaler_t prescaler, tmr1_wgm_t wgm, tmr1_com_t com, void (*cb)(void*), void* misc);
+
+extern void TMR1_compare_set(tmr1_compare_t comp, u16 val);
+
+extern void TMR1_start(void);
+
+extern void TMR1_stop(void);
+
+#endif	// __TIMER1_H__
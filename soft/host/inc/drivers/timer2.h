@@ -0,0 +1,35 @@
+#ifndef __TIMER2_H__
+# define __TIMER2_H__
+
+// host stand-in for the nanoK TIMER2 driver
+
+# include "type_def.h"
+
+typedef enum {
+	TMR2_WITHOUT_INTERRUPT,
+	TMR2_WITH_OVERFLOW_INT,
+	TMR2_WITH_COMPARE_INT,
+} tmr2_int_t;
+
+typedef enum {
+	TMR2_PRESCALER_1,
+	TMR2_PRESCALER_8,
+	TMR2_PRESCALER_32,
+	TMR2_PRESCALER_64,
+	TMR2_PRESCALER_128,
+	TMR2_PRESCALER_256,
+	TMR2_PRESCALER_1024,
+} tmr2_prescaler_t;
+
+typedef enum {
+	TMR2_WGM_NORMAL,
+	TMR2_WGM_CTC,
+} tmr2_wgm_t;
+
+extern void TMR2_init(tmr2_int_t it, tmr2_prescaler_t prescaler, tmr2_wgm_t wgm, u8 top, void (*cb)(void*), void* misc);
+
+extern void TMR2_start(void);
+
+extern u8 TMR2_get_value(void);
+
+#endif	// __TIMER2_H__
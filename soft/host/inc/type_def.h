@@ -0,0 +1,21 @@
+#ifndef __TYPE_DEF_H__
+# define __TYPE_DEF_H__
+
+// host stand-in for the nanoK type definitions
+
+# include <stdint.h>
+# include <stddef.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+#define KO	0
+#define OK	1
+
+#endif	// __TYPE_DEF_H__
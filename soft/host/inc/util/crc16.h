@@ -0,0 +1,20 @@
+#ifndef __UTIL_CRC16_H__
+# define __UTIL_CRC16_H__
+
+// host stand-in for the avr-libc CRC-16 (poly 0xa001)
+
+# include <stdint.h>
+
+static inline uint16_t _crc16_update(uint16_t crc, uint8_t a)
+{
+	int i;
+
+	crc ^= a;
+	for (i = 0; i < 8; i++) {
+		crc = (crc & 1) ? (crc >> 1) ^ 0xa001 : (crc >> 1);
+	}
+
+	return crc;
+}
+
+#endif	// __UTIL_CRC16_H__
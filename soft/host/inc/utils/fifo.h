@@ -0,0 +1,29 @@
+#ifndef __FIFO_H__
+# define __FIFO_H__
+
+// host stand-in for the nanoK fifo
+
+# include "type_def.h"
+
+typedef struct {
+	u8 lng;			// current number of elements
+	u8 nb;			// max number of elements
+	u8 size;		// element size
+	u8* in;
+	u8* out;
+	u8* buf;
+} fifo_t;
+
+extern void FIFO_init(fifo_t* f, void* buf, u8 nb, u8 elem_size);
+
+// return OK if the element is stored
+extern u8 FIFO_put(fifo_t* f, void* elem);
+
+// return OK if an element is retrieved
+extern u8 FIFO_get(fifo_t* f, void* elem);
+
+extern u8 FIFO_full(fifo_t* f);
+
+extern u8 FIFO_free(fifo_t* f);
+
+#endif	// __FIFO_H__
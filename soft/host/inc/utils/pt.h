@@ -0,0 +1,48 @@
+#ifndef __PT_H__
+# define __PT_H__
+
+// host stand-in for the nanoK protothreads (switch based)
+
+typedef struct {
+	unsigned int lc;
+} pt_t;
+
+#define PT_WAITING	0
+#define PT_YIELDED	1
+#define PT_EXITED	2
+#define PT_ENDED	3
+
+#define PT_THREAD(name_args)	char name_args
+
+#define PT_INIT(pt)		(pt)->lc = 0
+
+#define PT_BEGIN(pt)	{ char PT_YIELD_FLAG = 1; (void)PT_YIELD_FLAG; switch ( (pt)->lc ) { case 0:
+
+#define PT_END(pt)		} PT_YIELD_FLAG = 0; PT_INIT(pt); return PT_ENDED; }
+
+// a block rather than a do/while, as some callers omit the semicolon
+#define PT_WAIT_UNTIL(pt, cond)	\
+	{ (pt)->lc = __LINE__; case __LINE__: if ( !(cond) ) return PT_WAITING; }
+
+#define PT_WAIT_WHILE(pt, cond)		PT_WAIT_UNTIL((pt), !(cond))
+
+#define PT_WAIT_THREAD(pt, thread)	PT_WAIT_WHILE((pt), PT_SCHEDULE(thread))
+
+#define PT_SPAWN(pt, child, thread)	\
+	do { PT_INIT((child)); PT_WAIT_THREAD((pt), (thread)); } while (0)
+
+#define PT_RESTART(pt)	do { PT_INIT(pt); return PT_WAITING; } while (0)
+
+#define PT_EXIT(pt)		do { PT_INIT(pt); return PT_EXITED; } while (0)
+
+#define PT_SCHEDULE(f)	((f) < PT_EXITED)
+
+#define PT_YIELD(pt)	\
+	do { PT_YIELD_FLAG = 0; (pt)->lc = __LINE__; case __LINE__: if ( PT_YIELD_FLAG == 0 ) return PT_YIELDED; } while (0)
+
+#define PT_YIELD_UNTIL(pt, cond)	\
+	do { PT_YIELD_FLAG = 0; (pt)->lc = __LINE__; case __LINE__: if ( (PT_YIELD_FLAG == 0) || !(cond) ) return PT_YIELDED; } while (0)
+
+#define PT_YIELD_WHILE(pt, cond)	PT_YIELD_UNTIL((pt), !(cond))
+
+#endif	// __PT_H__
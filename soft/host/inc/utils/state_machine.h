@@ -0,0 +1,38 @@
+#ifndef __STATE_MACHINE_H__
+# define __STATE_MACHINE_H__
+
+// host stand-in for the nanoK state machine
+
+# include "type_def.h"
+# include "utils/pt.h"
+
+typedef struct stm_state_t stm_state_t;
+typedef struct stm_transition_t stm_transition_t;
+
+// transitions of a state are chained through tr
+struct stm_transition_t {
+	u8 ev;
+	const stm_state_t* st;
+	const stm_transition_t* tr;
+};
+
+// the action is a protothread run again and again while in the state
+struct stm_state_t {
+	u8 (*action)(pt_t* pt, void* args);
+	const stm_transition_t* transition;
+};
+
+typedef struct {
+	const stm_state_t* curr;
+	pt_t pt;
+	void* args;
+} stm_t;
+
+extern void STM_init(stm_t* stm, const stm_state_t* st);
+
+// follow the transition matching the event if any
+extern void STM_event(stm_t* stm, u8 ev);
+
+extern void STM_run(stm_t* stm);
+
+#endif	// __STATE_MACHINE_H__
@@ -0,0 +1,24 @@
+#ifndef __TIME_H__
+# define __TIME_H__
+
+// host stand-in for the nanoK time base
+// the time is the simulated time driven by the host loop
+
+# include "type_def.h"
+
+#define TIME_1_USEC	1UL
+#define TIME_1_MSEC	(1000UL * TIME_1_USEC)
+#define TIME_1_SEC	(1000UL * TIME_1_MSEC)
+#define TIME_MAX	0xffffffffUL
+
+extern void TIME_init(u32 (*adjust)(void));
+
+extern void TIME_set_incr(u32 incr);
+
+extern u32 TIME_get_incr(void);
+
+extern void TIME_incr(void);
+
+extern u32 TIME_get(void);
+
+#endif	// __TIME_H__
@@ -0,0 +1,232 @@
+#include "host.h"
+
+#include "utils/fifo.h"
+#include "utils/time.h"
+#include "utils/state_machine.h"
+#include "drivers/timer1.h"
+#include "drivers/timer2.h"
+
+#include <string.h>		// memcpy()
+
+
+// host stand-ins for the nanoK services used by the flight modules
+
+
+// ------------------------------------------
+// private variables
+//
+
+static struct {
+	u32 now;					// simulated time [us]
+
+	struct {
+		u8 started;
+		tmr1_int_t it;
+		void (*cb)(void*);
+		void* misc;
+		u16 cmp[3];				// A, B and capture
+	} tmr1;
+} NNK;
+
+
+// ------------------------------------------
+// fifo
+//
+
+void FIFO_init(fifo_t* f, void* buf, u8 nb, u8 elem_size)
+{
+	f->lng = 0;
+	f->nb = nb;
+	f->size = elem_size;
+	f->buf = buf;
+	f->in = buf;
+	f->out = buf;
+}
+
+
+u8 FIFO_put(fifo_t* f, void* elem)
+{
+	if ( f->lng >= f->nb ) {
+		return KO;
+	}
+
+	memcpy(f->in, elem, f->size);
+	f->in += f->size;
+	if ( f->in >= f->buf + f->nb * f->size ) {
+		f->in = f->buf;
+	}
+	f->lng++;
+
+	return OK;
+}
+
+
+u8 FIFO_get(fifo_t* f, void* elem)
+{
+	if ( f->lng == 0 ) {
+		return KO;
+	}
+
+	memcpy(elem, f->out, f->size);
+	f->out += f->size;
+	if ( f->out >= f->buf + f->nb * f->size ) {
+		f->out = f->buf;
+	}
+	f->lng--;
+
+	return OK;
+}
+
+
+u8 FIFO_full(fifo_t* f)
+{
+	return f->lng >= f->nb ? OK : KO;
+}
+
+
+u8 FIFO_free(fifo_t* f)
+{
+	return f->nb - f->lng;
+}
+
+
+// ------------------------------------------
+// time
+//
+
+void TIME_init(u32 (*adjust)(void))
+{
+	(void)adjust;
+}
+
+
+void TIME_set_incr(u32 incr)
+{
+	(void)incr;
+}
+
+
+u32 TIME_get_incr(void)
+{
+	return 0;
+}
+
+
+void TIME_incr(void)
+{
+}
+
+
+u32 TIME_get(void)
+{
+	return NNK.now;
+}
+
+
+void HST_time_step(u32 dt)
+{
+	NNK.now += dt;
+}
+
+
+// ------------------------------------------
+// state machine
+//
+
+void STM_init(stm_t* stm, const stm_state_t* st)
+{
+	stm->curr = st;
+	stm->args = NULL;
+	PT_INIT(&stm->pt);
+}
+
+
+void STM_event(stm_t* stm, u8 ev)
+{
+	const stm_transition_t* tr;
+
+	for ( tr = stm->curr->transition; tr != NULL; tr = tr->tr ) {
+		if ( tr->ev == ev ) {
+			// the new state action starts from its beginning
+			stm->curr = tr->st;
+			PT_INIT(&stm->pt);
+			return;
+		}
+	}
+}
+
+
+void STM_run(stm_t* stm)
+{
+	(void)stm->curr->action(&stm->pt, stm->args);
+}
+
+
+// ------------------------------------------
+// timers
+//
+
+void TMR1_init(tmr1_int_t it, tmr1_prescaler_t prescaler, tmr1_wgm_t wgm, tmr1_com_t com, void (*cb)(void*), void* misc)
+{
+	(void)prescaler;
+	(void)wgm;
+	(void)com;
+
+	NNK.tmr1.it = it;
+	NNK.tmr1.cb = cb;
+	NNK.tmr1.misc = misc;
+}
+
+
+void TMR1_compare_set(tmr1_compare_t comp, u16 val)
+{
+	NNK.tmr1.cmp[comp] = val;
+}
+
+
+void TMR1_start(void)
+{
+	NNK.tmr1.started = 1;
+}
+
+
+void TMR1_stop(void)
+{
+	NNK.tmr1.started = 0;
+}
+
+
+void HST_tmr1_overflow(void)
+{
+	if ( NNK.tmr1.started && NNK.tmr1.it == TMR1_WITH_OVERFLOW_INT && NNK.tmr1.cb ) {
+		NNK.tmr1.cb(NNK.tmr1.misc);
+	}
+}
+
+
+u16 HST_tmr1_compare(tmr1_compare_t comp)
+{
+	return NNK.tmr1.cmp[comp];
+}
+
+
+void TMR2_init(tmr2_int_t it, tmr2_prescaler_t prescaler, tmr2_wgm_t wgm, u8 top, void (*cb)(void*), void* misc)
+{
+	(void)it;
+	(void)prescaler;
+	(void)wgm;
+	(void)top;
+	(void)cb;
+	(void)misc;
+}
+
+
+void TMR2_start(void)
+{
+}
+
+
+u8 TMR2_get_value(void)
+{
+	return 0;
+}
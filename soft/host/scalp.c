@@ -0,0 +1,245 @@
+#include "host.h"
+
+#include "dispatcher.h"
+
+#include "utils/fifo.h"
+
+
+// host stand-in for the scalp dispatcher
+//
+// the accepted frames wait in a single queue.
+// DPT_run() hands each of them to every registered interface
+// whose command mask matches, except its sender.
+// a frame stays queued until every receiver has room for it,
+// and a receiver that is full is not given any later frame
+// during the same pass so the order is kept.
+// the frames for other nodes (not DPT_SELF_ADDR) are only spied.
+
+
+// ------------------------------------------
+// private definitions
+//
+
+#define DPT_INTERF_NB	16
+#define DPT_QUEUE_SIZE	32
+
+
+// ------------------------------------------
+// private types
+//
+
+typedef struct {
+	frame_t fr;
+	dpt_interface_t* from;		// NULL for the injected frames
+	u32 done;					// 1 bit per interface already served
+	u8 sent;					// every receiver has it
+} dpt_pending_t;
+
+
+// ------------------------------------------
+// private variables
+//
+
+static struct {
+	dpt_interface_t* interf[DPT_INTERF_NB];
+	u8 nb;
+
+	dpt_pending_t queue[DPT_QUEUE_SIZE];
+	u8 in;
+	u8 len;
+
+	void (*spy)(const dpt_interface_t* from, const frame_t* fr);
+} DPT;
+
+
+// ------------------------------------------
+// private functions
+//
+
+static u8 DPT_enqueue(dpt_interface_t* from, frame_t* fr)
+{
+	dpt_pending_t* p;
+
+	if ( DPT.len >= DPT_QUEUE_SIZE ) {
+		return KO;
+	}
+
+	p = &DPT.queue[(DPT.in + DPT.len) % DPT_QUEUE_SIZE];
+	p->fr = *fr;
+	p->from = from;
+	p->done = 0;
+	p->sent = 0;
+	DPT.len++;
+
+	if ( DPT.spy ) {
+		DPT.spy(from, fr);
+	}
+
+	return OK;
+}
+
+
+// return OK once every receiver has the frame
+static u8 DPT_deliver(dpt_pending_t* p, u32* blocked)
+{
+	u8 i;
+	u8 all = OK;
+
+	// not for this node
+	if ( p->fr.dest != DPT_SELF_ADDR ) {
+		return OK;
+	}
+
+	for (i = 0; i < DPT.nb; i++) {
+		if ( DPT.interf[i] == p->from || (p->done & (1UL << i)) ) {
+			continue;
+		}
+
+		if ( ! (DPT.interf[i]->cmde_mask & _CM(p->fr.cmde)) ) {
+			continue;
+		}
+
+		if ( (*blocked & (1UL << i)) || OK != FIFO_put(DPT.interf[i]->queue, &p->fr) ) {
+			*blocked |= 1UL << i;
+			all = KO;
+			continue;
+		}
+
+		p->done |= 1UL << i;
+	}
+
+	return all;
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void DPT_init(void)
+{
+	DPT.nb = 0;
+	DPT.in = 0;
+	DPT.len = 0;
+}
+
+
+void DPT_run(void)
+{
+	u32 blocked = 0;
+	u8 i;
+	u8 n = DPT.len;
+
+	for (i = 0; i < n; i++) {
+		dpt_pending_t* p = &DPT.queue[(DPT.in + i) % DPT_QUEUE_SIZE];
+
+		if ( ! p->sent && OK == DPT_deliver(p, &blocked) ) {
+			p->sent = 1;
+		}
+	}
+
+	// only the oldest frames can leave the queue
+	while ( DPT.len && DPT.queue[DPT.in].sent ) {
+		DPT.in = (DPT.in + 1) % DPT_QUEUE_SIZE;
+		DPT.len--;
+	}
+}
+
+
+void DPT_register(dpt_interface_t* interf)
+{
+	if ( DPT.nb < DPT_INTERF_NB ) {
+		DPT.interf[DPT.nb] = interf;
+		DPT.nb++;
+	}
+}
+
+
+// the in-process routing needs no exclusive access
+void DPT_lock(dpt_interface_t* interf)
+{
+	(void)interf;
+}
+
+
+void DPT_unlock(dpt_interface_t* interf)
+{
+	(void)interf;
+}
+
+
+u8 DPT_tx(dpt_interface_t* interf, frame_t* fr)
+{
+	return DPT_enqueue(interf, fr);
+}
+
+
+u8 HST_dpt_inject(frame_t* fr)
+{
+	return DPT_enqueue(NULL, fr);
+}
+
+
+void HST_dpt_spy(void (*spy)(const dpt_interface_t* from, const frame_t* fr))
+{
+	DPT.spy = spy;
+}
+
+
+// ------------------------------------------
+// frame helpers
+//
+
+u8 frame_set_6(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1, u8 a2, u8 a3, u8 a4, u8 a5)
+{
+	fr->dest = dest;
+	fr->orig = orig;
+	fr->t_id = 0;
+	fr->cmde = cmde;
+	fr->status = 0;
+	fr->len = len;
+	fr->argv[0] = a0;
+	fr->argv[1] = a1;
+	fr->argv[2] = a2;
+	fr->argv[3] = a3;
+	fr->argv[4] = a4;
+	fr->argv[5] = a5;
+
+	return OK;
+}
+
+
+u8 frame_set_5(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1, u8 a2, u8 a3, u8 a4)
+{
+	return frame_set_6(fr, dest, orig, cmde, len, a0, a1, a2, a3, a4, 0);
+}
+
+
+u8 frame_set_4(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1, u8 a2, u8 a3)
+{
+	return frame_set_6(fr, dest, orig, cmde, len, a0, a1, a2, a3, 0, 0);
+}
+
+
+u8 frame_set_3(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1, u8 a2)
+{
+	return frame_set_6(fr, dest, orig, cmde, len, a0, a1, a2, 0, 0, 0);
+}
+
+
+u8 frame_set_2(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0, u8 a1)
+{
+	return frame_set_6(fr, dest, orig, cmde, len, a0, a1, 0, 0, 0, 0);
+}
+
+
+u8 frame_set_1(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len, u8 a0)
+{
+	return frame_set_6(fr, dest, orig, cmde, len, a0, 0, 0, 0, 0, 0);
+}
+
+
+u8 frame_set_0(frame_t* fr, u8 dest, u8 orig, u8 cmde, u8 len)
+{
+	return frame_set_6(fr, dest, orig, cmde, len, 0, 0, 0, 0, 0, 0);
+}
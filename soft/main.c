@@ -2,6 +2,13 @@
 #include "servo.h"
 #include "mpu6050.h"
 #include "tk-off.h"
+#include "prof.h"
+#include "ram.h"
+#include "pool.h"
+#include "rec.h"
+#include "tlm.h"
+#include "cfg.h"
+#include "bmp280.h"
 
 #include "drivers/timer2.h"
 #include "utils/pt.h"
@@ -20,11 +27,14 @@
 
 #include "avr/io.h"
 #include "avr/interrupt.h"
+#include "avr/sleep.h"
 
 #if 0
 arduino	atmega	function
 -------+-------+--------
 
+D2      PD2     MPU int
+
 D8      PB0     SS/
 mosi    PB3     mosi
 miso    PB4     miso
@@ -45,6 +55,7 @@ MPU-6050		function
 
 sda				sda
 scl				scl
+int				interrupt (D2)
 
 +5V				power in
 GND				ground
@@ -165,12 +176,15 @@ const struct avr_mmcu_vcd_trace_t simavr_conf[]  _MMCU_ = {
 
 //#define TIMER2_TOP_VALUE	78	// @ 8 MHz ==> 10 ms
 #define TIMER2_TOP_VALUE	156	// @ 16 MHz ==> 10 ms
+#define TIMER2_PAD_TOP_VALUE	250	// @ 16 MHz ==> 16 ms, while the IMU waits on the pad
 
 
 // ------------------------------------------
 // private variables
 //
 
+static u8 tick_top;		// current timer2 top value
+
 
 // ------------------------------
 // private functions
@@ -193,7 +207,21 @@ static u32 time_adjust(void)
 	val = TMR2_get_value();
 	incr = TIME_get_incr();
 
-	return incr * val / TIMER2_TOP_VALUE;
+	return incr * val / tick_top;
+}
+
+
+// program timer2 for an interrupt on compare every tick
+static void tick_set(u8 top, u32 incr)
+{
+	u8 sreg = SREG;
+
+	cli();
+	TMR2_init(TMR2_WITH_COMPARE_INT, TMR2_PRESCALER_1024, TMR2_WGM_CTC, top, time, NULL);
+	TIME_set_incr(incr);
+	tick_top = top;
+	TMR2_start();
+	SREG = sreg;
 }
 
 
@@ -222,41 +250,98 @@ int main(void)
 
 	// init on-board time
 	TIME_init(time_adjust);
-	TIME_set_incr(10 * TIME_1_MSEC);
 
 	// program and start timer2 for interrupt on compare every 10 ms
-	TMR2_init(TMR2_WITH_COMPARE_INT, TMR2_PRESCALER_1024, TMR2_WGM_CTC, TIMER2_TOP_VALUE, time, NULL);
-	TMR2_start();
+	tick_set(TIMER2_TOP_VALUE, 10 * TIME_1_MSEC);
 
 	// enable interrupts
 	sei();
 
+	// the boot configuration is read by the module inits
+	CFG_init();
+
 	// init every common module
 	DPT_init();
+	POOL_init();
 	BSC_init();
 	CMN_init();
+#ifdef USE_TELEMETRY
+	TLM_init();
+#else
 	NAT_init();
+#endif
 //	LOG_init();
 	CPU_init();
 
 	MNT_init();
 	SRV_init();
 	MPU_init();
+#ifdef USE_BMP280
+	BMP_init();
+#endif
 	TKF_init();
+	REC_init();
+	PRF_init();
+	RAM_init();
 
 	while (1) {
+		u16 loop = PRF_start();
+
 		// run every common module
-		DPT_run();
-		BSC_run();
-		CMN_run();
-		NAT_run();
+		PRF_RUN(PRF_DPT, DPT_run);
+		PRF_RUN(PRF_BSC, BSC_run);
+		PRF_RUN(PRF_CMN, CMN_run);
+#ifdef USE_TELEMETRY
+		PRF_RUN(PRF_NAT, TLM_run);
+#else
+		PRF_RUN(PRF_NAT, NAT_run);
+#endif
 //		LOG_run();
-		CPU_run();
-
-		MNT_run();
-		SRV_run();
-		MPU_run();
-		TKF_run();
+		PRF_RUN(PRF_CPU, CPU_run);
+
+		PRF_RUN(PRF_MNT, MNT_run);
+		PRF_RUN(PRF_SRV, SRV_run);
+		PRF_RUN(PRF_MPU, MPU_run);
+		PRF_RUN(PRF_TKF, TKF_run);
+		PRF_RUN(PRF_REC, REC_run);
+#ifdef USE_BMP280
+		PRF_RUN(PRF_BMP, BMP_run);
+#endif
+		PRF_RUN(PRF_RAM, RAM_run);
+		PRF_RUN(PRF_PRF, PRF_run);
+
+		PRF_stop(PRF_LOOP, loop);
+
+		// while the IMU waits for a motion, the time base ticks slower
+		// and the superloop sleeps until the next interrupt
+		// unless a frame is still in flight.
+		// the servo period interrupt is masked if it has nothing to do.
+		cli();
+		if ( OK == MPU_low_power() ) {
+			if ( tick_top != TIMER2_PAD_TOP_VALUE ) {
+				tick_set(TIMER2_PAD_TOP_VALUE, 16 * TIME_1_MSEC);
+			}
+
+			if ( OK == POOL_idle() ) {
+				u8 srv = SRV_sleep();
+
+				set_sleep_mode(SLEEP_MODE_IDLE);
+				sleep_enable();
+
+				// the sleep instruction is executed before any pending interrupt
+				sei();
+				sleep_cpu();
+
+				sleep_disable();
+				if ( OK == srv ) {
+					SRV_wake();
+				}
+			}
+		}
+		else if ( tick_top != TIMER2_TOP_VALUE ) {
+			tick_set(TIMER2_TOP_VALUE, 10 * TIME_1_MSEC);
+		}
+		sei();
 	}
 
 	// this point is never reached
@@ -0,0 +1,55 @@
+#ifndef __MARK_H__
+# define __MARK_H__
+
+
+// deployment chain markers
+//
+// each step from the take-off detection to the cone servo command
+// writes its id in GPIOR1 (a single instruction).
+// the simulator watches the register to time the chain,
+// GPIOR0 being left to the benchmark image markers.
+//
+// every frame sent through a pool fifo also writes its command in GPIOR2,
+// and a state batch frame writes MRK_STATE + its state in GPIOR1,
+// so the simulator can check the frames and states of a scenario.
+// only the ids are defined here, the files using MRK() include avr/io.h
+// and the ones using MRK_FRAME() dispatcher.h.
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// comment the define below to remove the markers from the build
+#define USE_MARKERS
+
+// GPIOR1 and GPIOR2 in the data space of the ATmega328P, for the simulator
+#define MRK_ADDR		0x4a
+#define MRK_FRM_ADDR	0x4b
+
+#define MRK_TAKE_OFF	0x01	// take-off detected, FR_TAKE_OFF sent
+#define MRK_FLIGHT		0x02	// flight state entered
+#define MRK_DECISION	0x03	// first entry in cone open state
+#define MRK_CONE_OPEN	0x04	// cone servo driven open
+#define MRK_STATE		0x10	// + FR_STATE_xxx, state entry signaled
+
+
+// ------------------------------------------
+// public functions
+//
+
+#ifdef USE_MARKERS
+# define MRK(id)		GPIOR1 = (id)
+# define MRK_FRAME(fr)												\
+	do {															\
+		if ( (fr)->cmde == FR_MINUT_BATCH ) {						\
+			GPIOR1 = MRK_STATE + (fr)->argv[0];						\
+		}															\
+		GPIOR2 = (fr)->cmde;										\
+	} while (0)
+#else
+# define MRK(id)
+# define MRK_FRAME(fr)
+#endif
+
+#endif	// __MARK_H__
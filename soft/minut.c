@@ -1,4 +1,9 @@
 #include "minut.h"
+#include "servo.h"
+#include "mpu6050.h"
+#include "pool.h"
+#include "cfg.h"
+#include "mark.h"
 
 #include "type_def.h"
 #include "dispatcher.h"
@@ -12,9 +17,6 @@
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 
-//for debug
-#define static
-
 
 // ------------------------------------------
 // private definitions
@@ -23,6 +25,7 @@
 #define NB_EVENTS	5
 #define NB_CMDS		3
 #define NB_OUT_FR	4
+#define NB_STATES	4		// state reports queued for the common module
 
 #define CONE_DDR			DDRB
 #define CONE				PINB
@@ -30,9 +33,41 @@
 #define CONE_STATE_CLOSED	0
 #define CONE_STATE_OPEN		_BV(CONE_PIN)
 
-#define SAMPLING_START		(2 * TIME_1_SEC)
+// each state entry is signaled with a single FR_MINUT_BATCH frame
+// unpacked by every concerned module :
+//	argv[0] : new state (FR_STATE_xxx), for the common module
+//	argv[1] : cone servo command (FR_SERVO_OPEN/CLOSE/OFF), for the servo module
+//	argv[2] : aero servo command, for the servo module
+//	argv[3] : led alive period [10 ms], for the common module
+//	argv[4] : led open period [10 ms], for the common module
+// a field set to FR_BATCH_KEEP is left unchanged
+//
+// as long as the scalp common module doesn't decode the batch,
+// its state and led fields are also sent with FR_STATE and FR_LED_CMD
+// by a dedicated thread. every state entry is reported in order,
+// while only the latest led periods are sent if several batches
+// are emitted meanwhile.
+
 #define SAMPLING_PERIOD		(100 * TIME_1_MSEC)
 
+// the backup deployment fires that long after the flight time [100 ms]
+#define BACKUP_MARGIN		5
+
+// the apogee is passed once the pressure stays above its minimum
+// by more than the hysteresis (about 4 m) for several samples
+#define APOGEE_HYST			50		// [Pa]
+#define APOGEE_NB			3
+
+// deployment latency figures
+#define LAT_TKF_DECISION	0x00	// take-off to deploy decision
+#define LAT_DECISION_PWM	0x01	// deploy decision to cone PWM change
+#define LAT_PWM_CONFIRM		0x02	// cone PWM change to cone switch open
+#define LAT_TKF_CONFIRM		0x03	// take-off to cone switch open
+#define LAT_RESET_ARMED		0x04	// reset to armed (waiting state with the IMU ready)
+#define LAT_TKF_APOGEE		0x05	// take-off to apogee detection
+
+#define LAT_NONE			0xffff	// figure not available
+
 
 // ------------------------------------------
 // private types
@@ -58,6 +93,7 @@ struct {
 	pt_t pt_chk_time_out;	// checking time-out thread
 	pt_t pt_chk_cmds;	// checking commands thread
 	pt_t pt_out;		// sending thread
+	pt_t pt_common;		// state and led frames thread
 
 	stm_t stm;
 
@@ -71,6 +107,24 @@ struct {
 
 	u8 cone_state;
 
+	// deployment time stamps, 0 until the event occurs
+	struct {
+		u32 take_off;		// take-off event received
+		u32 decision;		// first entry in cone open state
+		u32 pwm;			// cone PWM change following the decision
+		u32 confirm;		// cone switch reporting open after the decision
+		u8 retries;			// cone open attempts after the first one
+	} lat;
+
+	// apogee detection from the barometer
+	u32 press_min;		// lowest pressure since take-off [Pa]
+	u8 press_rise;		// consecutive samples above the minimum
+	u32 apogee;			// apogee detection time, 0 until detected
+
+	// boot time stamps, 0 until the event occurs
+	u32 waiting;		// first entry in waiting state
+	u32 armed;			// waiting state with the IMU ready
+
 	// events fifo
 	fifo_t ev_fifo;
 	mnt_event_t ev_buf[NB_EVENTS];
@@ -78,13 +132,21 @@ struct {
 	// incoming commands fifo
 	fifo_t cmds_fifo;
 	frame_t cmds_buf[NB_CMDS];
-	frame_t cmd_fr;
-
-	// outcoming frames fifo
-	fifo_t out_fifo;
-	frame_t out_buf[NB_OUT_FR];
-
-	frame_t out_fr;		// frame for the sending thread
+	pool_hdl_t cmd_hdl;	// command being processed
+
+	// outcoming frames handles fifo
+	pool_fifo_t out_fifo;
+	pool_hdl_t out_buf[NB_OUT_FR];
+
+	// state and led fields of the batches still to be sent
+	// to the common module
+	struct {
+		u8 state[NB_STATES];	// state reports, oldest at out
+		u8 out;
+		u8 nb;
+		u8 led_alive;			// FR_BATCH_KEEP once sent
+		u8 led_open;
+	} common;
 
 	u8 started:1;		// signal to application can be started
 } MNT;
@@ -270,31 +332,43 @@ static const stm_state_t parachute = {
 // private functions
 //
 
-static u8 init_action(pt_t* pt, void* args)
+// keep the state and led fields of the batch for the common module
+static void MNT_common(frame_t* fr)
 {
-	frame_t fr;
+	u8 in;
 
-	PT_BEGIN(pt);
+	if ( fr->argv[0] != FR_BATCH_KEEP ) {
+		// if too many states follow each other, the oldest report is lost
+		if ( MNT.common.nb == NB_STATES ) {
+			MNT.common.out = (MNT.common.out + 1) % NB_STATES;
+			MNT.common.nb--;
+		}
+
+		in = (MNT.common.out + MNT.common.nb) % NB_STATES;
+		MNT.common.state[in] = fr->argv[0];
+		MNT.common.nb++;
+	}
+	if ( fr->argv[3] != FR_BATCH_KEEP ) {
+		MNT.common.led_alive = fr->argv[3];
+	}
+	if ( fr->argv[4] != FR_BATCH_KEEP ) {
+		MNT.common.led_open = fr->argv[4];
+	}
+}
 
-	// signal init state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_INIT)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
 
-	// cmde cone stop
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_CONE, FR_SERVO_OFF)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+static u8 init_action(pt_t* pt, void* args)
+{
+	frame_t* fr;
+	pool_hdl_t hdl;
 
-	// cmde aero stop
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_AERO, FR_SERVO_OFF)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	PT_BEGIN(pt);
 
-	// led alive 0.25s
-	PT_WAIT_UNTIL(pt, frame_set_3(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_ALIVE, FR_LED_SET, 25)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// init state, stop both servos, led alive 0.25s
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_INIT, FR_SERVO_OFF, FR_SERVO_OFF, 25, FR_BATCH_KEEP);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	PT_YIELD_WHILE(pt, OK);
 
@@ -304,19 +378,16 @@ static u8 init_action(pt_t* pt, void* args)
 
 static u8 cone_opening_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal cone opening state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_CONE_OPENING)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde cone open
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_CONE, FR_SERVO_OPEN)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// cone opening state, cone open
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_CONE_OPENING, FR_SERVO_OPEN, FR_BATCH_KEEP, FR_BATCH_KEEP, FR_BATCH_KEEP);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	// time-out 5s
 	MNT.time_out = TIME_get() + 5 * TIME_1_SEC;
@@ -329,38 +400,20 @@ static u8 cone_opening_action(pt_t* pt, void* args)
 
 static u8 aero_opening_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal aero opening state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_AERO_OPENING)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde aero open
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_AERO, FR_SERVO_OPEN)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde cone open
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_CONE, FR_SERVO_OPEN)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// aero opening state, aero and cone open, led alive and open 0.5s
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_AERO_OPENING, FR_SERVO_OPEN, FR_SERVO_OPEN, 50, 50);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	// time-out 5s
 	MNT.time_out = TIME_get() + 5 * TIME_1_SEC;
 
-	// led alive 0.5s
-	PT_WAIT_UNTIL(pt, frame_set_3(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_ALIVE, FR_LED_SET, 50)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// led open 0.5s
-	PT_WAIT_UNTIL(pt, frame_set_3(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_OPEN, FR_LED_SET, 50)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
 	PT_YIELD_WHILE(pt, OK);
 
 	PT_END(pt);
@@ -369,19 +422,16 @@ static u8 aero_opening_action(pt_t* pt, void* args)
 
 static u8 aero_open_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal aero open state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_AERO_OPEN)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde aero close
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_AERO, FR_SERVO_CLOSE)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// aero open state, aero close
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_AERO_OPEN, FR_BATCH_KEEP, FR_SERVO_CLOSE, FR_BATCH_KEEP, FR_BATCH_KEEP);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	PT_YIELD_WHILE(pt, OK);
 
@@ -391,19 +441,16 @@ static u8 aero_open_action(pt_t* pt, void* args)
 
 static u8 cone_closing_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal cone closing state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_CONE_CLOSING)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde aero stop
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_AERO, FR_SERVO_OFF)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// cone closing state, aero stop
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_CONE_CLOSING, FR_BATCH_KEEP, FR_SERVO_OFF, FR_BATCH_KEEP, FR_BATCH_KEEP);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	// time-out 5s
 	MNT.time_out = TIME_get() + 5 * TIME_1_SEC;
@@ -416,33 +463,20 @@ static u8 cone_closing_action(pt_t* pt, void* args)
 
 static u8 cone_closed_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal cone closed state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_CONE_CLOSED)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde cone close
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_CONE, FR_SERVO_CLOSE)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// cone closed state, cone close, led alive 0.1s, led open off
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_CONE_CLOSED, FR_SERVO_CLOSE, FR_BATCH_KEEP, 10, 0);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	// time-out 1s
 	MNT.time_out = TIME_get() + 1 * TIME_1_SEC;
 
-	// led alive 0.1s
-	PT_WAIT_UNTIL(pt, frame_set_3(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_ALIVE, FR_LED_SET, 10)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// led open off 0.0s
-	PT_WAIT_UNTIL(pt, frame_set_3(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_OPEN, FR_LED_SET, 0)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
 	PT_YIELD_WHILE(pt, OK);
 
 	PT_END(pt);
@@ -451,24 +485,20 @@ static u8 cone_closed_action(pt_t* pt, void* args)
 
 static u8 waiting_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal waiting state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_WAITING)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde cone stop
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_CONE, FR_SERVO_OFF)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	if ( MNT.waiting == 0 ) {
+		MNT.waiting = TIME_get();
+	}
 
-	// led alive 1s
-	PT_WAIT_UNTIL(pt, frame_set_3(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_ALIVE, FR_LED_SET, 100)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// waiting state, cone stop, led alive 1s
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_WAITING, FR_SERVO_OFF, FR_BATCH_KEEP, 100, FR_BATCH_KEEP);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	PT_YIELD_WHILE(pt, OK);
 
@@ -478,32 +508,25 @@ static u8 waiting_action(pt_t* pt, void* args)
 
 static u8 flight_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal flight state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_FLIGHT)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde cone close
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_CONE, FR_SERVO_CLOSE)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde aero close
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_AERO, FR_SERVO_CLOSE)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// whatever happens to the superloop, the cone will be opened
+	// so it is armed before waiting for any slot
+	SRV_backup_arm(MNT.open_time + BACKUP_MARGIN);
 
-	// time-out = flight time
+	// time-out = flight time, counted from the take-off detection
 	MNT.time_out = MNT.open_time * TIME_1_SEC / 10 + TIME_get();
 
-	// led alive 0.1s
-	PT_WAIT_UNTIL(pt, frame_set_3(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_ALIVE, FR_LED_SET, 10)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	MRK(MRK_FLIGHT);
+
+	// flight state, cone and aero close, led alive 0.1s
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_FLIGHT, FR_SERVO_CLOSE, FR_SERVO_CLOSE, 10, FR_BATCH_KEEP);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	PT_YIELD_WHILE(pt, OK);
 
@@ -513,29 +536,25 @@ static u8 flight_action(pt_t* pt, void* args)
 
 static u8 cone_open_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal cone open state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_CONE_OPEN)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde cone open
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_CONE, FR_SERVO_OPEN)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde aero stop
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_AERO, FR_SERVO_OFF)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// first deploy decision or new attempt after braking
+	if ( MNT.lat.decision == 0 ) {
+		MRK(MRK_DECISION);
+		MNT.lat.decision = TIME_get();
+	}
+	else {
+		MNT.lat.retries++;
+	}
 
-	// led open 0.1s
-	PT_WAIT_UNTIL(pt, frame_set_3(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_OPEN, FR_LED_SET, 10)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// cone open state, cone open, aero stop, led open 0.1s
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_CONE_OPEN, FR_SERVO_OPEN, FR_SERVO_OFF, FR_BATCH_KEEP, 10);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	// time-out 0.1s
 	MNT.time_out = TIME_get() + 100 * TIME_1_MSEC;
@@ -548,24 +567,16 @@ static u8 cone_open_action(pt_t* pt, void* args)
 
 static u8 braking_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal braking state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_BRAKING)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde cone stop
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_CONE, FR_SERVO_OFF)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
-
-	// cmde aero open
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_AERO, FR_SERVO_OPEN)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// braking state, cone stop, aero open
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_BRAKING, FR_SERVO_OFF, FR_SERVO_OPEN, FR_BATCH_KEEP, FR_BATCH_KEEP);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
 
 	// time-out 0.1s
 	MNT.time_out = TIME_get() + 100 * TIME_1_MSEC;
@@ -578,31 +589,57 @@ static u8 braking_action(pt_t* pt, void* args)
 
 static u8 parachute_action(pt_t* pt, void* args)
 {
-	frame_t fr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
-	// signal parachute state
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, FR_STATE_PARACHUTE)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	// parachute state, stop both servos, led open 1s
+	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+	frame_set_5(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_BATCH, 0, FR_STATE_PARACHUTE, FR_SERVO_OFF, FR_SERVO_OFF, FR_BATCH_KEEP, 100);
+	MNT_common(fr);
+	POOL_commit(&MNT.out_fifo, hdl);
+
+	PT_YIELD_WHILE(pt, OK);
 
-	// cmde cone stop
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_CONE, FR_SERVO_OFF)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+	PT_END(pt);
+}
 
-	// cmde aero stop
-	PT_WAIT_UNTIL(pt, frame_set_2(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_SERVO_CMD, 0, FR_SERVO_AERO, FR_SERVO_OFF)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
 
-	// led open 1s
-	PT_WAIT_UNTIL(pt, frame_set_3(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_OPEN, FR_LED_SET, 100)
-			&& OK == FIFO_put(&MNT.out_fifo, &fr)
-	);
+// send the state and led frames to the common module
+static PT_THREAD( MNT_send_common(pt_t* pt) )
+{
+	frame_t* fr;
+	pool_hdl_t hdl;
 
-	PT_YIELD_WHILE(pt, OK);
+	PT_BEGIN(pt);
+
+	PT_WAIT_UNTIL(pt, MNT.common.nb || MNT.common.led_alive != FR_BATCH_KEEP || MNT.common.led_open != FR_BATCH_KEEP);
+
+	// the oldest state report
+	if ( MNT.common.nb ) {
+		PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+		frame_set_2(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_STATE, 0, FR_STATE_SET, MNT.common.state[MNT.common.out]);
+		POOL_commit(&MNT.out_fifo, hdl);
+		MNT.common.out = (MNT.common.out + 1) % NB_STATES;
+		MNT.common.nb--;
+	}
+
+	if ( MNT.common.led_alive != FR_BATCH_KEEP ) {
+		PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+		frame_set_3(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_ALIVE, FR_LED_SET, MNT.common.led_alive);
+		POOL_commit(&MNT.out_fifo, hdl);
+		MNT.common.led_alive = FR_BATCH_KEEP;
+	}
+
+	if ( MNT.common.led_open != FR_BATCH_KEEP ) {
+		PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&MNT.out_fifo, &hdl)));
+		frame_set_3(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_LED_CMD, 0, FR_LED_OPEN, FR_LED_SET, MNT.common.led_open);
+		POOL_commit(&MNT.out_fifo, hdl);
+		MNT.common.led_open = FR_BATCH_KEEP;
+	}
+
+	PT_RESTART(pt);
 
 	PT_END(pt);
 }
@@ -635,6 +672,12 @@ static PT_THREAD( MNT_check_cone(pt_t* pt) )
 	// else generate the correspondig change event
 	switch (MNT.cone_state) {
 		case CONE_STATE_OPEN:
+			// deployment confirmation
+			if ( MNT.lat.decision && ! MNT.lat.confirm ) {
+				MNT.lat.confirm = TIME_get();
+				SRV_backup_disarm();
+			}
+
 			PT_WAIT_UNTIL(pt, (ev = MNT_EV_CONE_OPEN) && OK == FIFO_put(&MNT.ev_fifo, &ev) );
 			break;
 
@@ -695,45 +738,170 @@ static void MNT_open_time(frame_t* fr)
 }
 
 
+// latency in ms between 2 time stamps
+static u16 MNT_latency_ms(u32 from, u32 to)
+{
+	u32 dt;
+
+	if ( from == 0 || to == 0 || to < from ) {
+		return LAT_NONE;
+	}
+
+	dt = (to - from) / TIME_1_MSEC;
+	if ( dt >= LAT_NONE ) {
+		return LAT_NONE - 1;
+	}
+
+	return dt;
+}
+
+
+static void MNT_latency(frame_t* fr)
+{
+	u16 val;
+	u8 retries = MNT.lat.retries;
+
+	switch ( fr->argv[0] ) {
+	case LAT_TKF_DECISION:
+		val = MNT_latency_ms(MNT.lat.take_off, MNT.lat.decision);
+		break;
+
+	case LAT_DECISION_PWM:
+		val = MNT_latency_ms(MNT.lat.decision, MNT.lat.pwm);
+		break;
+
+	case LAT_PWM_CONFIRM:
+		val = MNT_latency_ms(MNT.lat.pwm, MNT.lat.confirm);
+		break;
+
+	case LAT_TKF_CONFIRM:
+		val = MNT_latency_ms(MNT.lat.take_off, MNT.lat.confirm);
+		break;
+
+	case LAT_TKF_APOGEE:
+		val = MNT_latency_ms(MNT.lat.take_off, MNT.apogee);
+		break;
+
+	case LAT_RESET_ARMED:
+		// the on-board time starts at reset
+		val = LAT_NONE;
+		if ( MNT.armed ) {
+			val = MNT.armed / TIME_1_MSEC < LAT_NONE ? MNT.armed / TIME_1_MSEC : LAT_NONE - 1;
+		}
+
+		// the retries are the IMU set-ups restarted on time-out
+		retries = MPU_init_retries();
+		break;
+
+	default:
+		// bad sub-command
+		fr->error = 1;
+		return;
+	}
+
+	fr->argv[1] = (val & 0xff00) >> 8;
+	fr->argv[2] = (val & 0x00ff) >> 0;
+	fr->argv[3] = retries;
+	fr->argv[4] = SRV_backup_fired();
+}
+
+
+// follow the pressure from the take-off to detect the apogee
+static void MNT_apogee(frame_t* fr)
+{
+	u32 press;
+
+	if ( ! MNT.lat.take_off || MNT.apogee ) {
+		return;
+	}
+
+	press = ((u32)fr->argv[0] << 24) | ((u32)fr->argv[1] << 16) | ((u32)fr->argv[2] << 8) | fr->argv[3];
+
+	// still climbing
+	if ( press < MNT.press_min ) {
+		MNT.press_min = press;
+		MNT.press_rise = 0;
+		return;
+	}
+
+	if ( press > MNT.press_min + APOGEE_HYST ) {
+		MNT.press_rise++;
+		if ( MNT.press_rise >= APOGEE_NB ) {
+			MNT.apogee = TIME_get();
+		}
+	}
+	else {
+		MNT.press_rise = 0;
+	}
+}
+
+
 static PT_THREAD( MNT_check_commands(pt_t* pt) )
 {
 	mnt_event_t ev;
+	frame_t* fr;
 	u8 swap;
 
 	PT_BEGIN(pt);
 
 	// as long as there are no command
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MNT.cmds_fifo, &MNT.cmd_fr));
+	PT_WAIT_UNTIL(pt, OK == POOL_get_frame(&MNT.cmds_fifo, &MNT.cmd_hdl));
+
+	// the command is processed in place
+	fr = POOL_frame(MNT.cmd_hdl);
 
 	// silently ignore incoming response
-	if ( MNT.cmd_fr.resp == 1 ) {
+	if ( fr->resp == 1 ) {
+		POOL_release(MNT.cmd_hdl);
 		DPT_unlock(&MNT.interf);
 		PT_RESTART(pt);
 	}
 
-	switch (MNT.cmd_fr.cmde) {
+	switch (fr->cmde) {
 		case FR_TAKE_OFF:
+			// only the first one is time stamped
+			if ( MNT.lat.take_off == 0 ) {
+				MNT.lat.take_off = TIME_get();
+			}
+
 			// generate take-off event
 			PT_WAIT_UNTIL(pt, (ev = MNT_EV_TAKE_OFF) && OK == FIFO_put(&MNT.ev_fifo, &ev) );
 			break;
 
 		case FR_MINUT_TIME_OUT:
-			MNT_open_time(&MNT.cmd_fr);
+			MNT_open_time(fr);
+			break;
+
+		case FR_MINUT_LATENCY:
+			MNT_latency(fr);
 			break;
 
 		case FR_STATE:
-			if ( (MNT.cmd_fr.argv[0] == 0x7a) || (MNT.cmd_fr.argv[0] == 0x8b) ) {
-				//MNT.state = MNT.cmd_fr.argv[1];
+			if ( (fr->argv[0] == 0x7a) || (fr->argv[0] == 0x8b) ) {
+				//MNT.state = fr->argv[1];
 			}
 
 			// don't respond, response will be done by CMN
+			POOL_release(MNT.cmd_hdl);
+			PT_RESTART(pt);
+			break;
+
+		case FR_DATA_PRESS:
+			MNT_apogee(fr);
+
+			// don't respond
+			POOL_release(MNT.cmd_hdl);
 			PT_RESTART(pt);
 			break;
 
 		case FR_APPLI_START:
 			MNT.started = 1;
 
+			// start sampling the cone right now
+			MNT.sampling_rate = TIME_get();
+
 			// don't respond
+			POOL_release(MNT.cmd_hdl);
 			PT_RESTART(pt);
 			break;
 
@@ -742,14 +910,21 @@ static PT_THREAD( MNT_check_commands(pt_t* pt) )
 			break;
 	}
 
+	// the sender doesn't want any response
+	if ( OK != POOL_resp_wanted(fr) ) {
+		POOL_release(MNT.cmd_hdl);
+		PT_RESTART(pt);
+	}
+
 	// build the response to the current command
-	swap = MNT.cmd_fr.orig;
-	MNT.cmd_fr.orig = MNT.cmd_fr.dest;
-	MNT.cmd_fr.dest = swap;
-	MNT.cmd_fr.resp = 1;
+	fr = POOL_frame(MNT.cmd_hdl);
+	swap = fr->orig;
+	fr->orig = fr->dest;
+	fr->dest = swap;
+	fr->resp = 1;
 
-	// enqueue it
-	PT_WAIT_UNTIL(pt, OK == FIFO_put(&MNT.out_fifo, &MNT.cmd_fr));
+	// enqueue it, the slot is released once sent
+	PT_WAIT_UNTIL(pt, OK == POOL_put(&MNT.out_fifo, MNT.cmd_hdl));
 
 	PT_RESTART(pt);
 
@@ -757,35 +932,14 @@ static PT_THREAD( MNT_check_commands(pt_t* pt) )
 }
 
 
-static PT_THREAD( MNT_send_frame(pt_t* pt) )
-{
-	PT_BEGIN(pt);
-
-	// wait until an outgoing frame is available
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MNT.out_fifo, &MNT.out_fr));
-
-	// send the frame throught the dispatcher
-	DPT_lock(&MNT.interf);
-
-	// some retry may be needed
-	PT_WAIT_UNTIL(pt, OK == DPT_tx(&MNT.interf, &MNT.out_fr));
-
-	// release the dispatcher
-	DPT_unlock(&MNT.interf);
-
-	// loop back for the next frame to send
-	PT_RESTART(pt);
-	
-	PT_END(pt);
-}
-
-
 // ------------------------------------------
 // public functions
 //
 
 void MNT_init(void)
 {
+	const cfg_t* cfg;
+
 	// init state machine
 	STM_init(&MNT.stm, &init);
 
@@ -798,11 +952,14 @@ void MNT_init(void)
 	// init fifoes
 	FIFO_init(&MNT.ev_fifo, MNT.ev_buf, NB_EVENTS, sizeof(mnt_event_t));
 	FIFO_init(&MNT.cmds_fifo, MNT.cmds_buf, NB_CMDS, sizeof(frame_t));
-	FIFO_init(&MNT.out_fifo, MNT.out_buf, NB_OUT_FR, sizeof(frame_t));
+	POOL_fifo_init(&MNT.out_fifo, MNT.out_buf, NB_OUT_FR);
+
+	// the responses to the state entry batches are useless
+	POOL_fifo_no_resp(&MNT.out_fifo);
 
 	// register to dispatcher
 	MNT.interf.channel = 7;
-	MNT.interf.cmde_mask = _CM(FR_TAKE_OFF) | _CM(FR_MINUT_TIME_OUT) | _CM(FR_STATE) | _CM(FR_APPLI_START);
+	MNT.interf.cmde_mask = _CM(FR_TAKE_OFF) | _CM(FR_MINUT_TIME_OUT) | _CM(FR_STATE) | _CM(FR_APPLI_START) | _CM(FR_MINUT_LATENCY) | _CM(FR_DATA_PRESS);
 	MNT.interf.queue = &MNT.cmds_fifo;
 	DPT_register(&MNT.interf);
 
@@ -810,13 +967,32 @@ void MNT_init(void)
 	PT_INIT(&MNT.pt_chk_time_out);
 	PT_INIT(&MNT.pt_chk_cmds);
 	PT_INIT(&MNT.pt_out);
+	PT_INIT(&MNT.pt_common);
+
+	// nothing to send to the common module yet
+	MNT.common.out = 0;
+	MNT.common.nb = 0;
+	MNT.common.led_alive = FR_BATCH_KEEP;
+	MNT.common.led_open = FR_BATCH_KEEP;
 
 	// prevent any time-out
 	MNT.time_out = TIME_MAX;
-	MNT.sampling_rate = SAMPLING_START;
+	MNT.sampling_rate = TIME_MAX;
+	MNT.waiting = 0;
+	MNT.armed = 0;
+
+	MNT.press_min = 0xffffffff;
+	MNT.press_rise = 0;
+	MNT.apogee = 0;
 
 	// the application start signal shall be received
 	MNT.started = 0;
+
+	// flight time from the boot configuration
+	cfg = CFG_get();
+	if ( cfg ) {
+		MNT.open_time = cfg->open_time;
+	}
 }
 
 
@@ -853,8 +1029,27 @@ void MNT_run(void)
 
 		// update state machine
 		STM_run(&MNT.stm);
+
+		// get the first cone PWM change following the deploy decision
+		if ( MNT.lat.decision && ! MNT.lat.pwm && SRV_cone_moved() >= MNT.lat.decision ) {
+			MNT.lat.pwm = SRV_cone_moved();
+		}
+
+		// armed once waiting for the take-off with the IMU ready
+		if ( MNT.waiting && ! MNT.armed && OK == MPU_ready() ) {
+			MNT.armed = TIME_get();
+		}
 	}
 
+	// mirror the batches for the common module
+	(void)PT_SCHEDULE(MNT_send_common(&MNT.pt_common));
+
 	// send outgoing frame(s) if any
-	(void)PT_SCHEDULE(MNT_send_frame(&MNT.pt_out));
+	(void)PT_SCHEDULE(POOL_send(&MNT.pt_out, &MNT.out_fifo, &MNT.interf));
+}
+
+
+u16 MNT_ram(void)
+{
+	return sizeof(MNT);
 }
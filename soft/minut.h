@@ -1,6 +1,8 @@
 #ifndef __MINUT_H__
 # define __MINUT_H__
 
+# include "type_def.h"
+
 
 // ------------------------------------------
 // public functions
@@ -11,4 +13,7 @@ extern void MNT_init(void);
 
 extern void MNT_run(void);
 
+// static RAM used by the module
+extern u16 MNT_ram(void);
+
 #endif	// __MINUT_H__
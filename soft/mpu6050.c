@@ -1,11 +1,17 @@
 #include "mpu6050.h"
 
 #include "dispatcher.h"
+#include "pool.h"
+#include "decim.h"
 
 #include "utils/pt.h"
 #include "utils/fifo.h"
 #include "utils/time.h"
 
+#include "avr/io.h"
+#include "avr/interrupt.h"
+#include "avr/pgmspace.h"
+
 #include <string.h>		// memcpy()
 
 
@@ -26,6 +32,33 @@
 // STOP
 //
 
+// low-power pad mode:
+// while the minuterie is waiting on the pad, the MPU is put in
+// accelerometer-only cycle mode, waking up at LP_WAKE_CTRL rate
+// to check for a motion. a motion raises its INT pin, wired to INT0,
+// and the MPU is switched back to full-rate 6-axis sampling right away.
+// if no take-off follows, the cycle mode is entered again after a while.
+// in the meantime, no data is published and the AVR idle-sleeps
+// between interrupts (see MPU_low_power()).
+
+// adaptive sampling:
+// the acquisition period, the MPU sample rate and its DLPF follow
+// the flight phase given by the state batch of the minuterie :
+//	- pad : slow, except after a motion wake-up where a take-off may be under way,
+//	- flight (from take-off to the parachute) : full rate,
+//	- descent (under parachute) : moderate.
+//
+// decimation:
+// the MPU is read faster than the data are published.
+// the samples go through a decimation stage (see decim.h) with
+// a median spike rejection, so the take-off detector and the telemetry
+// only see clean data at the publishing rate.
+//
+// bus sharing:
+// the MPU keeps the priority on the SC18IS600 bus.
+// MPU_bus_idle() tells how long the bus stays unused until the next
+// acquisition, so the other devices (the barometer) only use the gaps.
+
 
 // ------------------------------------------
 // private definitions
@@ -39,15 +72,23 @@
 #endif
 
 #define IN_FIFO_SIZE	1
+#define OUT_FIFO_SIZE	2
 
 #define MPU_I2C_ADDR	(0x68 >> 1)
 
+#define MPU6050_DATA_RDY		0x01	// INT_ENABLE and INT_STATUS data ready bit
+
 #define MPU6050_WHO_AM_I		0x75
 #define MPU6050_SMPLRT_DIV		0x19
 #define MPU6050_CONFIG			0x1a
 #define MPU6050_GYRO_CONFIG		0x1b
 #define MPU6050_ACCEL_CONFIG	0x1c
+#define MPU6050_MOT_THR			0x1f
+#define MPU6050_MOT_DUR			0x20
+#define MPU6050_INT_ENABLE		0x38
+#define MPU6050_INT_STATUS		0x3a
 #define MPU6050_PWR_MGMT_1		0x6b
+#define MPU6050_PWR_MGMT_2		0x6c
 
 #define MPU6050_ACCEL_XOUT_H	0x3b
 #define MPU6050_ACCEL_XOUT_L	0x3c
@@ -64,15 +105,36 @@
 #define MPU6050_GYRO_ZOUT_H		0x47
 #define MPU6050_GYRO_ZOUT_L		0x48
 
+#define MPU_WAKE_DURATION		(5 * TIME_1_SEC)	// full rate duration after a motion wake-up
+#define MPU_RDY_TIME_OUT		(200 * TIME_1_MSEC)	// maximum wait of the first sample at set-up
+
+#define MPU_MEDIAN				1	// median spike rejection before decimation
+
+
+// ------------------------------------------
+// private types
+//
+
+typedef enum {
+	MPU_PHASE_PAD,
+	MPU_PHASE_FLIGHT,
+	MPU_PHASE_DESCENT,
+	MPU_PHASE_NB,
+} mpu_phase_t;
+
 
 // ------------------------------------------
 // private variables
 //
 
 struct {
-	pt_t pt;					// pt for sending thread
+	pt_t pt;					// pt for acquisition thread
+	pt_t pt_out;				// pt for sending thread
 	dpt_interface_t interf;		// interface to the dispatcher
 	u8 started;
+	u8 ready;					// the MPU is set up and sampling
+	u8 init_retries;			// set-ups restarted as the first sample never came
+	u8 idle;					// the thread waits without using the bus
 
 	pt_t pt_spawn;				// pt for spawned threads
 #ifdef USE_SC18IS600
@@ -85,8 +147,26 @@ struct {
 	fifo_t in_fifo;
 	frame_t in_fr;				// incoming frame for acquisitions or commands
 
+	pool_hdl_t out_buf[OUT_FIFO_SIZE];	// outgoing frames handles fifo
+	pool_fifo_t out_fifo;
+
 	u32 time_out;
 
+	u8 lp_req:1;				// low-power mode requested
+	u8 lp:1;					// low-power mode active
+	volatile u8 motion;			// motion detected by the MPU
+	u32 wake_time_out;			// end of the full rate period after a motion wake-up
+
+	mpu_phase_t phase;			// flight phase given by the minuterie
+	mpu_phase_t phase_cur;		// flight phase the MPU is configured for
+
+	dcm_t acc_dcm;				// accelerations decimation
+	dcm_t gyr_dcm;				// rotations decimation
+
+	const u8 (*wr)[2];			// register writing sequence
+	u8 wr_nb;
+	u8 wr_idx;
+
 	struct {
 		u8 acc_x_hi;			// accel X axis MSB
 		u8 acc_x_lo;			// accel X axis LSB
@@ -106,10 +186,179 @@ struct {
 } MPU;
 
 
+// ------------------------------------------
+// private constants
+//
+
+// accelerometer-only cycle mode with motion interrupt
+static const u8 MPU_lp_cfg[][2] PROGMEM = {
+	{ MPU6050_ACCEL_CONFIG, 0x19 },		// +-16G, high-pass filter at 5 Hz for motion detection
+	{ MPU6050_MOT_THR, 40 },			// motion threshold about 80 mg
+	{ MPU6050_MOT_DUR, 1 },				// over 1 sample
+	{ MPU6050_INT_ENABLE, 0x40 },		// motion interrupt only
+	{ MPU6050_PWR_MGMT_2, 0x87 },		// wake-up at 20 Hz, gyro in standby
+	{ MPU6050_PWR_MGMT_1, 0x28 },		// cycle mode, temperature sensor disabled
+};
+
+// full-rate 6-axis sampling
+static const u8 MPU_full_cfg[][2] PROGMEM = {
+	{ MPU6050_PWR_MGMT_1, 0x00 },		// quit cycle mode
+	{ MPU6050_PWR_MGMT_2, 0x00 },		// every axis on
+	{ MPU6050_INT_ENABLE, 0x00 },		// no interrupt
+	{ MPU6050_ACCEL_CONFIG, 0x18 },		// +-16G, no high-pass filter
+};
+
+
+// sample rate and DLPF for each flight phase
+static const u8 MPU_phase_cfg[MPU_PHASE_NB][2][2] PROGMEM = {
+	// pad : 50 Hz ( 1kHz / 20 ), DLPF at ~10 Hz
+	{ { MPU6050_SMPLRT_DIV, 19 }, { MPU6050_CONFIG, 0x05 } },
+
+	// flight : 200 Hz ( 1kHz / 5 ), DLPF at ~44 Hz
+	{ { MPU6050_SMPLRT_DIV, 4 }, { MPU6050_CONFIG, 0x03 } },
+
+	// descent : 40 Hz ( 1kHz / 25 ), DLPF at ~21 Hz
+	{ { MPU6050_SMPLRT_DIV, 24 }, { MPU6050_CONFIG, 0x04 } },
+};
+
+// acquisition period for each flight phase [ms]
+static const u8 MPU_phase_period[MPU_PHASE_NB] PROGMEM = {
+	50,		// pad
+	5,		// flight
+	25,		// descent
+};
+
+// decimation ratio for each flight phase
+// so the data are published every 100 ms, 10 ms and 50 ms
+static const u8 MPU_phase_ratio[MPU_PHASE_NB] PROGMEM = {
+	2,		// pad
+	2,		// flight
+	2,		// descent
+};
+
+
 // ------------------------------------------
 // private functions
 //
 
+// the MPU INT pin reports a motion
+ISR(INT0_vect)
+{
+	MPU.motion = 1;
+}
+
+
+// handle the incoming commands
+// return OK if the frame is not a command (typically an I2C response)
+static u8 MPU_command(frame_t* fr)
+{
+	switch ( fr->cmde ) {
+	case FR_APPLI_START:
+		MPU.started = 1;
+		break;
+
+	case FR_MINUT_BATCH:
+		// only the new state is of interest
+		if ( fr->resp || fr->argv[0] == FR_BATCH_KEEP ) {
+			break;
+		}
+
+		// the IMU sleeps while waiting on the pad
+		MPU.lp_req = ( fr->argv[0] == FR_STATE_WAITING );
+
+		switch ( fr->argv[0] ) {
+		case FR_STATE_FLIGHT:
+		case FR_STATE_CONE_OPEN:
+		case FR_STATE_BRAKING:
+			MPU.phase = MPU_PHASE_FLIGHT;
+			break;
+
+		case FR_STATE_PARACHUTE:
+			MPU.phase = MPU_PHASE_DESCENT;
+			break;
+
+		default:
+			MPU.phase = MPU_PHASE_PAD;
+			break;
+		}
+		break;
+
+	default:
+		return OK;
+	}
+
+	return KO;
+}
+
+
+// decimate the 3 x 16-bit MSB first values of data
+// return OK when the decimated values are set back in data
+static u8 MPU_decimate(dcm_t* dcm, u8* data)
+{
+	s16 val[DCM_AXES];
+	u8 i;
+
+	for (i = 0; i < DCM_AXES; i++) {
+		val[i] = (data[2 * i] << 8) | data[2 * i + 1];
+	}
+
+	if ( OK != DCM_put(dcm, val, val) ) {
+		return KO;
+	}
+
+	for (i = 0; i < DCM_AXES; i++) {
+		data[2 * i] = (val[i] & 0xff00) >> 8;
+		data[2 * i + 1] = (val[i] & 0x00ff) >> 0;
+	}
+
+	return OK;
+}
+
+
+// phase the acquisition shall be configured for
+static mpu_phase_t MPU_phase(void)
+{
+	// a motion on the pad may be a take-off
+	if ( MPU.phase == MPU_PHASE_PAD && TIME_get() < MPU.wake_time_out ) {
+		return MPU_PHASE_FLIGHT;
+	}
+
+	return MPU.phase;
+}
+
+
+// write the sequence of (register, value) pairs set in MPU.wr
+static PT_THREAD( MPU_write(pt_t* pt) )
+{
+#ifndef USE_SC18IS600
+	frame_t fr;
+#else
+	u8 tx[2];
+#endif
+
+	PT_BEGIN(pt);
+
+	for ( MPU.wr_idx = 0; MPU.wr_idx < MPU.wr_nb; MPU.wr_idx++ ) {
+#ifndef USE_SC18IS600
+		DPT_lock(&MPU.interf);
+		PT_WAIT_UNTIL(pt, frame_set_2(&fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_WRITE, 2, pgm_read_byte(&MPU.wr[MPU.wr_idx][0]), pgm_read_byte(&MPU.wr[MPU.wr_idx][1]))
+				&& DPT_tx(&MPU.interf, &fr));
+		// wait response
+		PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr) && OK == MPU_command(&fr));
+		DPT_unlock(&MPU.interf);
+#else
+		PT_WAIT_UNTIL(pt, OK == SC18IS600_lock());
+		tx[0] = pgm_read_byte(&MPU.wr[MPU.wr_idx][0]);
+		tx[1] = pgm_read_byte(&MPU.wr[MPU.wr_idx][1]);
+		MPU.n = 2;
+		PT_SPAWN(pt, &MPU.pt_spawn_2, SC18IS600_tx(&MPU.pt_spawn_2, MPU_I2C_ADDR, tx, &MPU.n));
+		SC18IS600_unlock();
+#endif
+	}
+
+	PT_END(pt);
+}
+
 
 static PT_THREAD( MPU_init_pt_thread(pt_t* pt) )
 {
@@ -129,7 +378,7 @@ static PT_THREAD( MPU_init_pt_thread(pt_t* pt) )
 	PT_WAIT_UNTIL(pt, frame_set_1(&fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_WRITE, 1, MPU6050_WHO_AM_I)
 			&& DPT_tx(&MPU.interf, &fr));
 	// wait response
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr));
+	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr) && OK == MPU_command(&fr));
 
 	// check it
 	if ( fr.resp != 1 || fr.error != 0 || fr.orig != MPU_I2C_ADDR ) {
@@ -147,7 +396,7 @@ static PT_THREAD( MPU_init_pt_thread(pt_t* pt) )
 	PT_WAIT_UNTIL(pt, frame_set_0(&fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_READ, 1)
 			&& DPT_tx(&MPU.interf, &fr));
 	// wait response
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr));
+	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr) && OK == MPU_command(&fr));
 #else
     MPU.n = 1;
     PT_SPAWN(pt, &MPU.pt_spawn_2, SC18IS600_rx(&MPU.pt_spawn_2, MPU_I2C_ADDR, MPU.rx, &MPU.n));
@@ -178,7 +427,7 @@ static PT_THREAD( MPU_init_pt_thread(pt_t* pt) )
 	PT_WAIT_UNTIL(pt, frame_set_5(&fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_WRITE, 5, MPU6050_SMPLRT_DIV, 0x09, 0x02, 0x08, 0x18)
 			&& DPT_tx(&MPU.interf, &fr));
 	// wait response
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr));
+	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr) && OK == MPU_command(&fr));
 #else
     tx[0] = MPU6050_SMPLRT_DIV;
     tx[1] = 0x09;
@@ -194,9 +443,7 @@ static PT_THREAD( MPU_init_pt_thread(pt_t* pt) )
 	PT_WAIT_UNTIL(pt, frame_set_2(&fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_WRITE, 2, MPU6050_PWR_MGMT_1, 0x00)
 			&& DPT_tx(&MPU.interf, &fr));
 	// wait response
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr));
-
-	DPT_unlock(&MPU.interf);
+	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr) && OK == MPU_command(&fr));
 #else
     tx[0] = MPU6050_PWR_MGMT_1;
     tx[1] = 0x00;
@@ -204,6 +451,56 @@ static PT_THREAD( MPU_init_pt_thread(pt_t* pt) )
     PT_SPAWN(pt, &MPU.pt_spawn_2, SC18IS600_tx(&MPU.pt_spawn_2, MPU_I2C_ADDR, tx, &MPU.n));
 #endif
 
+	// flag the data ready : INT_ENABLE = DATA_RDY_EN
+#ifndef USE_SC18IS600
+	PT_WAIT_UNTIL(pt, frame_set_2(&fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_WRITE, 2, MPU6050_INT_ENABLE, MPU6050_DATA_RDY)
+			&& DPT_tx(&MPU.interf, &fr));
+	// wait response
+	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr) && OK == MPU_command(&fr));
+#else
+    tx[0] = MPU6050_INT_ENABLE;
+    tx[1] = MPU6050_DATA_RDY;
+    MPU.n = 2;
+    PT_SPAWN(pt, &MPU.pt_spawn_2, SC18IS600_tx(&MPU.pt_spawn_2, MPU_I2C_ADDR, tx, &MPU.n));
+#endif
+
+	// rather than a fixed delay, poll INT_STATUS until the first sample is ready
+	// so the oscillator and the sensors have started up
+	// if it never comes, the whole set-up is done again
+	MPU.time_out = TIME_get() + MPU_RDY_TIME_OUT;
+#ifndef USE_SC18IS600
+	do {
+		if ( TIME_get() >= MPU.time_out ) {
+			MPU.init_retries++;
+			PT_RESTART(pt);
+		}
+
+		PT_WAIT_UNTIL(pt, frame_set_1(&fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_WRITE, 1, MPU6050_INT_STATUS)
+				&& DPT_tx(&MPU.interf, &fr));
+		PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr) && OK == MPU_command(&fr));
+
+		PT_WAIT_UNTIL(pt, frame_set_0(&fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_READ, 1)
+				&& DPT_tx(&MPU.interf, &fr));
+		PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr) && OK == MPU_command(&fr));
+	} while ( fr.resp != 1 || fr.error != 0 || ! (fr.argv[0] & MPU6050_DATA_RDY) );
+
+	DPT_unlock(&MPU.interf);
+#else
+	do {
+		if ( TIME_get() >= MPU.time_out ) {
+			MPU.init_retries++;
+			PT_RESTART(pt);
+		}
+
+		tx[0] = MPU6050_INT_STATUS;
+		MPU.n = 1;
+		PT_SPAWN(pt, &MPU.pt_spawn_2, SC18IS600_tx(&MPU.pt_spawn_2, MPU_I2C_ADDR, tx, &MPU.n));
+
+		MPU.n = 1;
+		PT_SPAWN(pt, &MPU.pt_spawn_2, SC18IS600_rx(&MPU.pt_spawn_2, MPU_I2C_ADDR, MPU.rx, &MPU.n));
+	} while ( ! (MPU.rx[0] & MPU6050_DATA_RDY) );
+#endif
+
 	PT_EXIT(pt);
 
 	PT_END(pt);
@@ -224,7 +521,7 @@ static PT_THREAD( MPU_acquisition(pt_t* pt, u8 len, frame_t* fr) )
 	PT_WAIT_UNTIL(pt, frame_set_0(fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_READ, len)
 			&& DPT_tx(&MPU.interf, fr));
 	// wait response
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, fr));
+	PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, fr) && OK == MPU_command(fr));
 #else
     MPU.n = len;
     PT_SPAWN(pt, &MPU.pt_spawn_2, SC18IS600_rx(&MPU.pt_spawn_2, MPU_I2C_ADDR, MPU.rx, &MPU.n));
@@ -250,36 +547,97 @@ static PT_THREAD( MPU_acquisition(pt_t* pt, u8 len, frame_t* fr) )
 static PT_THREAD( MPU_thread(pt_t* pt) )
 {
 	frame_t fr;
+	frame_t* out;
+	pool_hdl_t hdl;
 #ifdef USE_SC18IS600
     u8 tx[1];
-    u8 n;
 #endif
 
 	PT_BEGIN(pt);
 
-	// wait application start signal
-	if ( ! MPU.started ) {
-		PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr));
-		if ( fr.cmde == FR_APPLI_START ) {
-			MPU.started = 1;
-		}
-		else {
-			PT_RESTART(pt);
-		}
-	}
-
+	// the bridge and the MPU are set up from the reset
+	// while the minuterie runs its cone and servo sequence
 #ifdef USE_SC18IS600
     PT_SPAWN(pt, &MPU.pt_spawn, SC18IS600_init(&MPU.pt_spawn));
 #endif
 	// check MPU hardware init
 	PT_SPAWN(pt, &MPU.pt_spawn, MPU_init_pt_thread(&MPU.pt_spawn));
 
-	MPU.time_out = 1 * TIME_1_SEC;
+	MPU.ready = 1;
+
+	// the bus is free until the start signal
+	MPU.idle = 1;
+
+	// wait application start signal
+	while ( ! MPU.started ) {
+#ifndef USE_SC18IS600
+		PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr));
+		(void)MPU_command(&fr);
+#else
+		// the commands are handled by MPU_run()
+		PT_WAIT_UNTIL(pt, MPU.started);
+#endif
+	}
+
+	// the phase configuration is applied on the first acquisition
+	MPU.phase_cur = MPU_PHASE_NB;
+
+	// a sample is already available
+	MPU.time_out = TIME_get();
+	MPU.idle = 0;
 	while (1) {
-		// data acquisition every 10 ms (100 Hz)
+		// enter the low-power mode when requested
+		// but not before the end of the full rate period following a motion
+		if ( MPU.lp_req && ! MPU.lp && TIME_get() >= MPU.wake_time_out ) {
+			MPU.wr = MPU_lp_cfg;
+			MPU.wr_nb = sizeof(MPU_lp_cfg) / sizeof(MPU_lp_cfg[0]);
+			PT_SPAWN(pt, &MPU.pt_spawn, MPU_write(&MPU.pt_spawn));
+
+			// enable the motion interrupt
+			MPU.motion = 0;
+			EIFR = _BV(INTF0);
+			EIMSK |= _BV(INT0);
+
+			MPU.lp = 1;
+		}
+
+		if ( MPU.lp ) {
+			// sleep until a motion or the end of the low-power mode
+			MPU.idle = 1;
+			PT_WAIT_UNTIL(pt, MPU.motion || ! MPU.lp_req);
+			MPU.idle = 0;
+
+			EIMSK &= ~_BV(INT0);
+
+			// back to full-rate sampling
+			MPU.wr = MPU_full_cfg;
+			MPU.wr_nb = sizeof(MPU_full_cfg) / sizeof(MPU_full_cfg[0]);
+			PT_SPAWN(pt, &MPU.pt_spawn, MPU_write(&MPU.pt_spawn));
+
+			MPU.lp = 0;
+			MPU.wake_time_out = TIME_get() + MPU_WAKE_DURATION;
+
+			// and sample right now
+			MPU.time_out = TIME_get();
+		}
+
+		// follow the flight phase
+		if ( MPU_phase() != MPU.phase_cur ) {
+			MPU.phase_cur = MPU_phase();
+			MPU.wr = MPU_phase_cfg[MPU.phase_cur];
+			MPU.wr_nb = 2;
+			PT_SPAWN(pt, &MPU.pt_spawn, MPU_write(&MPU.pt_spawn));
+
+			DCM_init(&MPU.acc_dcm, pgm_read_byte(&MPU_phase_ratio[MPU.phase_cur]), MPU_MEDIAN);
+			DCM_init(&MPU.gyr_dcm, pgm_read_byte(&MPU_phase_ratio[MPU.phase_cur]), MPU_MEDIAN);
+		}
+
+		// data acquisition at the phase period
+		MPU.idle = 1;
 		PT_WAIT_UNTIL(pt, TIME_get() >= MPU.time_out);
+		MPU.idle = 0;
 
-		MPU.time_out += 100 * TIME_1_MSEC;
+		MPU.time_out += pgm_read_byte(&MPU_phase_period[MPU.phase_cur]) * TIME_1_MSEC;
 
 #ifndef USE_SC18IS600
 		DPT_lock(&MPU.interf);
@@ -290,11 +648,12 @@ static PT_THREAD( MPU_thread(pt_t* pt) )
 		PT_WAIT_UNTIL(pt, frame_set_1(&fr, MPU_I2C_ADDR, DPT_SELF_ADDR, FR_I2C_WRITE, 1, MPU6050_ACCEL_XOUT_H)
 				&& DPT_tx(&MPU.interf, &fr));
 		// wait response
-		PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr));
+		PT_WAIT_UNTIL(pt, OK == FIFO_get(&MPU.in_fifo, &fr) && OK == MPU_command(&fr));
 #else
+    PT_WAIT_UNTIL(pt, OK == SC18IS600_lock());
     tx[0] = MPU6050_ACCEL_XOUT_H;
-    n = 1;
-    PT_SPAWN(pt, &MPU.pt_spawn_2, SC18IS600_tx(&MPU.pt_spawn_2, MPU_I2C_ADDR, tx, &n));
+    MPU.n = 1;
+    PT_SPAWN(pt, &MPU.pt_spawn_2, SC18IS600_tx(&MPU.pt_spawn_2, MPU_I2C_ADDR, tx, &MPU.n));
 #endif
 
 #ifndef USE_SC18IS600
@@ -324,17 +683,25 @@ static PT_THREAD( MPU_thread(pt_t* pt) )
 		// save data
 		memcpy(&MPU.data.gyro_x_hi, &fr.argv[0], 6);
 
-		DPT_lock(&MPU.interf);
+#ifdef USE_SC18IS600
+		SC18IS600_unlock();
+#endif
 
-		// build and send the acceleration data
-		PT_WAIT_UNTIL(pt, frame_set_6(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_DATA_ACC, 6, MPU.data.acc_x_hi, MPU.data.acc_x_lo, MPU.data.acc_y_hi, MPU.data.acc_y_lo, MPU.data.acc_z_hi, MPU.data.acc_z_lo)
-				&& DPT_tx(&MPU.interf, &fr));
+		// publish only the decimated data
+		(void)MPU_decimate(&MPU.gyr_dcm, &MPU.data.gyro_x_hi);
+		if ( OK != MPU_decimate(&MPU.acc_dcm, &MPU.data.acc_x_hi) ) {
+			continue;
+		}
 
-		// build and send the gyroscopic data
-		PT_WAIT_UNTIL(pt, frame_set_6(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_DATA_GYR, 6, MPU.data.gyro_x_hi, MPU.data.gyro_x_lo, MPU.data.gyro_y_hi, MPU.data.gyro_y_lo, MPU.data.gyro_z_hi, MPU.data.gyro_z_lo)
-				&& DPT_tx(&MPU.interf, &fr));
+		// build and queue the acceleration data
+		PT_WAIT_UNTIL(pt, NULL != (out = POOL_reserve(&MPU.out_fifo, &hdl)));
+		frame_set_6(out, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_DATA_ACC, 6, MPU.data.acc_x_hi, MPU.data.acc_x_lo, MPU.data.acc_y_hi, MPU.data.acc_y_lo, MPU.data.acc_z_hi, MPU.data.acc_z_lo);
+		POOL_commit(&MPU.out_fifo, hdl);
 
-		DPT_unlock(&MPU.interf);
+		// build and queue the gyroscopic data
+		PT_WAIT_UNTIL(pt, NULL != (out = POOL_reserve(&MPU.out_fifo, &hdl)));
+		frame_set_6(out, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_DATA_GYR, 6, MPU.data.gyro_x_hi, MPU.data.gyro_x_lo, MPU.data.gyro_y_hi, MPU.data.gyro_y_lo, MPU.data.gyro_z_hi, MPU.data.gyro_z_lo);
+		POOL_commit(&MPU.out_fifo, hdl);
 	}
 
 	PT_END(pt);
@@ -349,20 +716,88 @@ void MPU_init(void)
 {
 	// init
 	FIFO_init(&MPU.in_fifo, &MPU.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
+	POOL_fifo_init(&MPU.out_fifo, MPU.out_buf, OUT_FIFO_SIZE);
+	POOL_fifo_data(&MPU.out_fifo);
 
 	MPU.interf.channel = 9;
 	//MPU.interf.cmde_mask = _CM(FR_I2C_READ) | _CM(FR_I2C_WRITE);
-	MPU.interf.cmde_mask = _CM(FR_I2C_READ) | _CM(FR_I2C_WRITE) | _CM(FR_APPLI_START);
+	MPU.interf.cmde_mask = _CM(FR_I2C_READ) | _CM(FR_I2C_WRITE) | _CM(FR_APPLI_START) | _CM(FR_MINUT_BATCH);
 	MPU.interf.queue = &MPU.in_fifo;
 	DPT_register(&MPU.interf);
 
 	MPU.started = 0;
+	MPU.ready = 0;
+	MPU.init_retries = 0;
+	MPU.idle = 0;
+
+	// the MPU INT pin rises on motion
+	EICRA |= _BV(ISC01) | _BV(ISC00);
+
+	MPU.lp_req = 0;
+	MPU.lp = 0;
+	MPU.wake_time_out = 0;
+	MPU.phase = MPU_PHASE_PAD;
 
 	PT_INIT(&MPU.pt);
+	PT_INIT(&MPU.pt_out);
 }
 
 
 void MPU_run(void)
 {
+#ifdef USE_SC18IS600
+	// the incoming frames are only commands
+	if ( OK == FIFO_get(&MPU.in_fifo, &MPU.in_fr) ) {
+		(void)MPU_command(&MPU.in_fr);
+	}
+#endif
+
 	(void)PT_SCHEDULE(MPU_thread(&MPU.pt));
+
+	// send outgoing frame(s) if any
+	(void)PT_SCHEDULE(POOL_send(&MPU.pt_out, &MPU.out_fifo, &MPU.interf));
+}
+
+
+u8 MPU_low_power(void)
+{
+	// a motion not yet handled is a pending event
+	return MPU.lp && ! MPU.motion ? OK : KO;
+}
+
+
+u8 MPU_ready(void)
+{
+	return MPU.ready ? OK : KO;
+}
+
+
+u8 MPU_init_retries(void)
+{
+	return MPU.init_retries;
+}
+
+
+u32 MPU_bus_idle(void)
+{
+	u32 now;
+
+	if ( ! MPU.ready || ! MPU.idle ) {
+		return 0;
+	}
+
+	// no acquisition before the start signal nor while waiting for a motion
+	if ( ! MPU.started || MPU.lp ) {
+		return TIME_MAX;
+	}
+
+	now = TIME_get();
+
+	return MPU.time_out > now ? MPU.time_out - now : 0;
+}
+
+
+u16 MPU_ram(void)
+{
+	return sizeof(MPU);
 }
@@ -1,10 +1,28 @@
 #ifndef __MPU6050_H__
 # define __MPU6050_H__
 
+# include "type_def.h"
+
 
 // MPU-6050 basic handling
 extern void MPU_init(void);
 
 extern void MPU_run(void);
 
+// return OK while the MPU is in low-power mode waiting for a motion
+// shall be called with the interrupts disabled to sleep on its result
+extern u8 MPU_low_power(void);
+
+// return OK once the MPU is set up and its first sample is ready
+extern u8 MPU_ready(void);
+
+// number of set-ups restarted because the first sample never came
+extern u8 MPU_init_retries(void);
+
+// time the MPU leaves the SC18IS600 bus unused from now, 0 if using it
+extern u32 MPU_bus_idle(void);
+
+// static RAM used by the module
+extern u16 MPU_ram(void);
+
 #endif	// __MPU6050_H__
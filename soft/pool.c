@@ -0,0 +1,335 @@
+#include "pool.h"
+#include "mark.h"
+
+// the frame markers are written in GPIOR1 and GPIOR2
+#ifdef USE_MARKERS
+# include <avr/io.h>
+#endif
+
+
+// ------------------------------------------
+// private variables
+//
+
+static struct {
+	frame_t slot[POOL_SIZE];	// frame storage
+	u8 ref[POOL_SIZE];			// reference counters, 0 means free
+	u8 urgent;					// urgent flag of each slot
+	u8 pending;					// urgent frames committed and not sent yet
+} POOL;
+
+
+// ------------------------------------------
+// private functions
+//
+
+// check if the frame in the slot shall overtake the normal ones
+static u8 POOL_is_urgent(pool_hdl_t hdl)
+{
+	if ( POOL.urgent & (1 << hdl) ) {
+		return OK;
+	}
+
+	switch ( POOL.slot[hdl].cmde ) {
+	case FR_TAKE_OFF:
+	case FR_STATE:
+	case FR_MINUT_SERVO_CMD:
+	case FR_MINUT_BATCH:
+		return OK;
+
+	default:
+		return KO;
+	}
+}
+
+
+// get a free slot if more than keep slots are free
+static pool_hdl_t POOL_take(u8 keep)
+{
+	pool_hdl_t i;
+	pool_hdl_t hdl = POOL_NONE;
+	u8 nb = 0;
+
+	for (i = 0; i < POOL_SIZE; i++) {
+		if ( POOL.ref[i] == 0 ) {
+			if ( hdl == POOL_NONE ) {
+				hdl = i;
+			}
+			nb++;
+		}
+	}
+
+	if ( nb <= keep ) {
+		return POOL_NONE;
+	}
+
+	POOL.ref[hdl] = 1;
+	POOL.urgent &= ~(1 << hdl);
+
+	return hdl;
+}
+
+
+// check if the oldest frame of the fifo can be sent
+static u8 POOL_admit(pool_fifo_t* q)
+{
+	// the sensor data give way to the urgent frames of the other fifoes
+	// but only for a while, an urgent frame stuck on its destination
+	// shall not stop them
+	if ( q->data && POOL.pending && q->yield < POOL_DATA_YIELD ) {
+		q->yield++;
+		return KO;
+	}
+
+	q->yield = 0;
+
+	return OK;
+}
+
+
+// position of the n-th handle of the fifo
+static u8 POOL_index(pool_fifo_t* q, u8 n)
+{
+	n += q->out;
+	if ( n >= q->size ) {
+		n -= q->size;
+	}
+
+	return n;
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void POOL_init(void)
+{
+	u8 i;
+
+	for (i = 0; i < POOL_SIZE; i++) {
+		POOL.ref[i] = 0;
+	}
+
+	POOL.urgent = 0;
+	POOL.pending = 0;
+}
+
+
+pool_hdl_t POOL_alloc(void)
+{
+	return POOL_take(0);
+}
+
+
+void POOL_ref(pool_hdl_t hdl)
+{
+	POOL.ref[hdl]++;
+}
+
+
+void POOL_release(pool_hdl_t hdl)
+{
+	if ( POOL.ref[hdl] ) {
+		POOL.ref[hdl]--;
+	}
+}
+
+
+frame_t* POOL_frame(pool_hdl_t hdl)
+{
+	return &POOL.slot[hdl];
+}
+
+
+u8 POOL_get_frame(fifo_t* fifo, pool_hdl_t* hdl)
+{
+	pool_hdl_t h;
+
+	h = POOL_alloc();
+	if ( h == POOL_NONE ) {
+		return KO;
+	}
+
+	// no frame available, give the slot back
+	if ( OK != FIFO_get(fifo, &POOL.slot[h]) ) {
+		POOL_release(h);
+		return KO;
+	}
+
+	*hdl = h;
+
+	return OK;
+}
+
+
+void POOL_fifo_init(pool_fifo_t* q, pool_hdl_t* buf, u8 size)
+{
+	q->size = size;
+	q->nb = 0;
+	q->urg = 0;
+	q->rsvd = 0;
+	q->out = 0;
+	q->no_resp = 0;
+	q->data = 0;
+	q->yield = 0;
+	q->buf = buf;
+}
+
+
+void POOL_fifo_no_resp(pool_fifo_t* q)
+{
+	q->no_resp = 1;
+}
+
+
+void POOL_fifo_data(pool_fifo_t* q)
+{
+	q->data = 1;
+}
+
+
+u8 POOL_resp_wanted(frame_t* fr)
+{
+	return fr->status & POOL_NO_RESP ? KO : OK;
+}
+
+
+frame_t* POOL_reserve(pool_fifo_t* q, pool_hdl_t* hdl)
+{
+	pool_hdl_t h;
+
+	// no more room in the fifo
+	if ( q->nb + q->rsvd >= q->size ) {
+		return NULL;
+	}
+
+	// the last slots are kept for the incoming commands
+	// so a module can always take the frames it has to answer
+	h = POOL_take(POOL_IN_RSVD);
+	if ( h == POOL_NONE ) {
+		return NULL;
+	}
+
+	q->rsvd++;
+	*hdl = h;
+
+	return &POOL.slot[h];
+}
+
+
+void POOL_urgent(pool_hdl_t hdl)
+{
+	POOL.urgent |= (1 << hdl);
+}
+
+
+void POOL_commit(pool_fifo_t* q, pool_hdl_t hdl)
+{
+	u8 i;
+
+	// the responses are never tagged
+	if ( q->no_resp && ! POOL.slot[hdl].resp ) {
+		POOL.slot[hdl].status |= POOL_NO_RESP;
+	}
+
+	if ( OK == POOL_is_urgent(hdl) ) {
+		POOL.urgent |= (1 << hdl);
+
+		// shift the normal handles to insert after the last urgent one
+		for (i = q->nb; i > q->urg; i--) {
+			q->buf[POOL_index(q, i)] = q->buf[POOL_index(q, i - 1)];
+		}
+		q->buf[POOL_index(q, q->urg)] = hdl;
+
+		q->urg++;
+		POOL.pending++;
+	}
+	else {
+		// the normal handles are appended in commit order
+		q->buf[POOL_index(q, q->nb)] = hdl;
+	}
+
+	q->nb++;
+	q->rsvd--;
+}
+
+
+void POOL_cancel(pool_fifo_t* q, pool_hdl_t hdl)
+{
+	q->rsvd--;
+	POOL_release(hdl);
+}
+
+
+u8 POOL_put(pool_fifo_t* q, pool_hdl_t hdl)
+{
+	// no more room in the fifo
+	if ( q->nb + q->rsvd >= q->size ) {
+		return KO;
+	}
+
+	q->rsvd++;
+	POOL_commit(q, hdl);
+
+	return OK;
+}
+
+
+PT_THREAD( POOL_send(pt_t* pt, pool_fifo_t* q, dpt_interface_t* interf) )
+{
+	PT_BEGIN(pt);
+
+	// wait until an outgoing frame is available
+	// the urgent ones being at the head of the fifo, they are sent first
+	PT_WAIT_UNTIL(pt, q->nb && OK == POOL_admit(q));
+
+	// send the oldest frame throught the dispatcher
+	DPT_lock(interf);
+
+	// some retry may be needed
+	// the handle stays in the fifo until the frame is sent
+	// so an urgent frame committed meanwhile is sent first
+	PT_WAIT_UNTIL(pt, OK == DPT_tx(interf, &POOL.slot[q->buf[q->out]]));
+	MRK_FRAME(&POOL.slot[q->buf[q->out]]);
+
+	// release the dispatcher
+	DPT_unlock(interf);
+
+	// and the frame
+	if ( q->urg ) {
+		q->urg--;
+		POOL.pending--;
+	}
+	POOL_release(q->buf[q->out]);
+	q->out++;
+	if ( q->out >= q->size ) {
+		q->out = 0;
+	}
+	q->nb--;
+
+	// loop back for the next frame to send
+	PT_RESTART(pt);
+
+	PT_END(pt);
+}
+
+
+u8 POOL_idle(void)
+{
+	u8 i;
+
+	for (i = 0; i < POOL_SIZE; i++) {
+		if ( POOL.ref[i] ) {
+			return KO;
+		}
+	}
+
+	return OK;
+}
+
+
+u16 POOL_ram(void)
+{
+	return sizeof(POOL);
+}
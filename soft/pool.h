@@ -0,0 +1,154 @@
+#ifndef __POOL_H__
+# define __POOL_H__
+
+# include "type_def.h"
+
+# include "dispatcher.h"
+# include "utils/fifo.h"
+# include "utils/pt.h"
+
+
+// shared pool of frames
+//
+// instead of copying full frames from fifo to fifo,
+// the modules allocate a slot from the pool and only hand its
+// one-byte handle around. a frame is then processed in place.
+//
+// each slot is reference counted, it returns to the pool
+// when its last user releases it.
+//
+// the outgoing fifoes carry handles. a producer first reserves a place
+// in the fifo together with a slot, builds the frame directly in the slot
+// then commits it. so a frame is built only once, even if the fifo
+// stays full for several superloop passes:
+//
+//	PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&out, &hdl)));
+//	frame_set_0(fr, ...);
+//	POOL_commit(&out, hdl);
+//
+// POOL_send() is the common thread emptying such a fifo
+// through a dispatcher interface.
+//
+// the frames carrying safety-critical commands (take-off, state, servo, batch)
+// or explicitly marked with POOL_urgent() are urgent. in a fifo,
+// they overtake the normal frames while keeping their own order.
+// the fifoes are independent, an urgent frame stuck in one of them
+// never blocks the others.
+//
+// the fifoes flagged with POOL_fifo_data() carry the sensor data.
+// while an urgent frame is pending in any fifo, they give way to it
+// for at most POOL_DATA_YIELD passes, so the urgent frame reaches the
+// dispatcher first. the frames already in the dispatcher queues
+// are not reordered.
+//
+// the last POOL_IN_RSVD free slots can only hold incoming frames
+// (POOL_get_frame()), not outgoing ones (POOL_reserve()).
+// so full outgoing fifoes can never prevent a module from taking
+// the commands it has to answer, which would deadlock the modules
+// sending to each other.
+//
+// a fifo can be flagged with POOL_fifo_no_resp() when its owner never
+// uses the responses to its commands. the commands committed in it
+// then carry the POOL_NO_RESP status bit, one of the 2 bits of the status
+// left unused by the dispatcher, and the receivers honouring it
+// (see POOL_resp_wanted()) execute them without answering.
+// the transaction id is left untouched, every value being a valid one.
+
+
+// ------------------------------------------
+// public definitions
+//
+
+#define POOL_SIZE	8			// at most 8, see urgent flags
+#define POOL_IN_RSVD	2		// slots kept for the incoming frames
+#define POOL_DATA_YIELD	8		// passes a data fifo gives way to the urgent frames
+
+#define POOL_NONE	0xff		// invalid handle
+
+#define POOL_NO_RESP	0x08	// status bit of the fire-and-forget commands
+
+
+// ------------------------------------------
+// public types
+//
+
+typedef u8 pool_hdl_t;
+
+// fifo of handles with reservation
+typedef struct {
+	u8 size;			// capacity
+	u8 nb;				// committed handles
+	u8 urg;				// urgent handles, at the head of the fifo
+	u8 rsvd;			// reserved places
+	u8 out;				// index of the oldest handle
+	u8 no_resp;			// commands are sent as fire-and-forget
+	u8 data;			// sensor data, giving way to the urgent frames
+	u8 yield;			// passes given way
+	pool_hdl_t* buf;
+} pool_fifo_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+extern void POOL_init(void);
+
+// get a free slot, its reference count is set to 1
+// return POOL_NONE if the pool is empty
+extern pool_hdl_t POOL_alloc(void);
+
+// add a user to the slot
+extern void POOL_ref(pool_hdl_t hdl);
+
+// remove a user from the slot, the last one frees it
+extern void POOL_release(pool_hdl_t hdl);
+
+// access to the frame stored in the slot
+extern frame_t* POOL_frame(pool_hdl_t hdl);
+
+// get a frame from a frame fifo (typically a dispatcher queue) into a new slot
+// return KO if the fifo is empty or the pool is exhausted
+extern u8 POOL_get_frame(fifo_t* fifo, pool_hdl_t* hdl);
+
+// init a fifo of handles using the given buffer
+extern void POOL_fifo_init(pool_fifo_t* q, pool_hdl_t* buf, u8 size);
+
+// the commands committed in the fifo will want no response
+extern void POOL_fifo_no_resp(pool_fifo_t* q);
+
+// the fifo carries sensor data, giving way to the urgent frames of the others
+extern void POOL_fifo_data(pool_fifo_t* q);
+
+// check if the sender of the command waits for a response
+extern u8 POOL_resp_wanted(frame_t* fr);
+
+// reserve a place in the fifo and a free slot
+// return the frame to build or NULL if the fifo or the pool is full
+extern frame_t* POOL_reserve(pool_fifo_t* q, pool_hdl_t* hdl);
+
+// mark the frame as urgent whatever its command
+// shall be called before the frame is committed
+extern void POOL_urgent(pool_hdl_t hdl);
+
+// make the reserved frame available to the consumer
+extern void POOL_commit(pool_fifo_t* q, pool_hdl_t hdl);
+
+// give back an unused reservation
+extern void POOL_cancel(pool_fifo_t* q, pool_hdl_t hdl);
+
+// enqueue an already built frame (typically a response processed in place)
+// return KO if the fifo is full
+extern u8 POOL_put(pool_fifo_t* q, pool_hdl_t hdl);
+
+// send every frame of the fifo through the dispatcher interface
+// each slot is released once sent
+extern PT_THREAD( POOL_send(pt_t* pt, pool_fifo_t* q, dpt_interface_t* interf) );
+
+// return OK if no frame is held in the pool, so no module has one to process
+extern u8 POOL_idle(void);
+
+// static RAM used by the module
+extern u16 POOL_ram(void);
+
+#endif	// __POOL_H__
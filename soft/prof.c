@@ -0,0 +1,247 @@
+#include "prof.h"
+
+#ifdef USE_PROFILING
+
+#include "dispatcher.h"
+
+#include "utils/pt.h"
+#include "utils/fifo.h"
+
+#include "avr/io.h"
+#include "avr/interrupt.h"
+
+
+// the measures rely on the TIMER1 counter
+// it is free-running for the servo PWM generation (see servo.c) :
+// prescaler 8 @ 16 MHz so 1 tick = 0.5 us,
+// and it wraps at ICR1 every 20 ms.
+// so every measure above 20 ms is truncated
+
+
+// ------------------------------------------
+// private definitions
+//
+
+#define IN_FIFO_SIZE	1
+
+#define PRF_MIN			0x00
+#define PRF_AVG			0x01
+#define PRF_MAX			0x02
+
+#define PRF_RESET		0xff
+
+
+// ------------------------------------------
+// private types
+//
+
+typedef struct {
+	u16 min;		// shortest run [0.5 us]
+	u16 max;		// longest run [0.5 us]
+	u32 sum;		// accumulated run times for the average
+	u16 nb;			// number of accumulated runs
+} prf_stat_t;
+
+
+// ------------------------------------------
+// private variables
+//
+
+struct {
+	pt_t pt;					// pt for the command thread
+	dpt_interface_t interf;		// interface to the dispatcher
+
+	frame_t in_buf[IN_FIFO_SIZE];
+	fifo_t in_fifo;
+
+	frame_t fr;					// command frame
+
+	prf_stat_t stat[PRF_NB];
+} PRF;
+
+
+// ------------------------------------------
+// private functions
+//
+
+// the 16-bit registers are read through the TEMP register
+// shared with the TIMER1 interrupt
+static u16 PRF_counter(void)
+{
+	u8 sreg = SREG;
+	u16 cnt;
+
+	cli();
+	cnt = TCNT1;
+	SREG = sreg;
+
+	return cnt;
+}
+
+
+static void PRF_reset(void)
+{
+	u8 i;
+
+	for (i = 0; i < PRF_NB; i++) {
+		PRF.stat[i].min = 0xffff;
+		PRF.stat[i].max = 0;
+		PRF.stat[i].sum = 0;
+		PRF.stat[i].nb = 0;
+	}
+}
+
+
+static void PRF_read(frame_t* fr)
+{
+	prf_stat_t* stat;
+	u16 val;
+
+	// reset request
+	if ( fr->argv[0] == PRF_RESET ) {
+		PRF_reset();
+		return;
+	}
+
+	// unknown entry
+	if ( fr->argv[0] >= PRF_NB ) {
+		fr->error = 1;
+		return;
+	}
+
+	stat = &PRF.stat[fr->argv[0]];
+
+	switch ( fr->argv[1] ) {
+	case PRF_MIN:
+		val = stat->nb ? stat->min : 0;
+		break;
+
+	case PRF_AVG:
+		val = stat->nb ? stat->sum / stat->nb : 0;
+		break;
+
+	case PRF_MAX:
+		val = stat->max;
+		break;
+
+	default:
+		// bad sub-command
+		fr->error = 1;
+		return;
+	}
+
+	fr->argv[2] = (val & 0xff00) >> 8;
+	fr->argv[3] = (val & 0x00ff) >> 0;
+}
+
+
+static PT_THREAD( PRF_thread(pt_t* pt) )
+{
+	u8 swap;
+
+	PT_BEGIN(pt);
+
+	// wait incoming commands
+	PT_WAIT_UNTIL(pt, OK == FIFO_get(&PRF.in_fifo, &PRF.fr));
+
+	// responses are ignored
+	if ( PRF.fr.resp ) {
+		DPT_unlock(&PRF.interf);
+		PT_RESTART(pt);
+	}
+
+	PRF.fr.error = 0;
+	PRF_read(&PRF.fr);
+
+	// send the response
+	swap = PRF.fr.orig;
+	PRF.fr.orig = PRF.fr.dest;
+	PRF.fr.dest = swap;
+	PRF.fr.resp = 1;
+
+	DPT_lock(&PRF.interf);
+	PT_WAIT_UNTIL(pt, OK == DPT_tx(&PRF.interf, &PRF.fr));
+	DPT_unlock(&PRF.interf);
+
+	PT_RESTART(pt);
+
+	PT_END(pt);
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void PRF_init(void)
+{
+	FIFO_init(&PRF.in_fifo, &PRF.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
+
+	PRF.interf.channel = 11;
+	PRF.interf.cmde_mask = _CM(FR_MINUT_PROFILE);
+	PRF.interf.queue = &PRF.in_fifo;
+	DPT_register(&PRF.interf);
+
+	PRF_reset();
+
+	PT_INIT(&PRF.pt);
+}
+
+
+void PRF_run(void)
+{
+	(void)PT_SCHEDULE(PRF_thread(&PRF.pt));
+}
+
+
+u16 PRF_start(void)
+{
+	return PRF_counter();
+}
+
+
+void PRF_stop(prf_module_t mod, u16 start)
+{
+	prf_stat_t* stat = &PRF.stat[mod];
+	u8 sreg = SREG;
+	u16 now;
+	u16 top;
+	u16 dt;
+
+	cli();
+	now = TCNT1;
+	top = ICR1;
+	SREG = sreg;
+
+	// take the counter wrap-around into account
+	if ( now >= start ) {
+		dt = now - start;
+	}
+	else {
+		dt = top + 1 - start + now;
+	}
+
+	if ( dt < stat->min ) {
+		stat->min = dt;
+	}
+
+	if ( dt > stat->max ) {
+		stat->max = dt;
+	}
+
+	// keep the average meaningful once the counter saturates
+	if ( stat->nb == 0xffff ) {
+		stat->sum >>= 1;
+		stat->nb >>= 1;
+	}
+	stat->sum += dt;
+	stat->nb++;
+}
+
+
+u16 PRF_ram(void)
+{
+	return sizeof(PRF);
+}
+
+#endif	// USE_PROFILING
@@ -0,0 +1,68 @@
+#ifndef __PROF_H__
+# define __PROF_H__
+
+# include "type_def.h"
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// comment the define below to remove the superloop profiling from the build
+#define USE_PROFILING
+
+// measured superloop entries
+// the order is the one used by the FR_MINUT_PROFILE frame
+typedef enum {
+	PRF_DPT,
+	PRF_BSC,
+	PRF_CMN,
+	PRF_NAT,		// or the telemetry when it replaces the NAT
+	PRF_CPU,
+	PRF_MNT,
+	PRF_SRV,
+	PRF_MPU,
+	PRF_TKF,
+	PRF_REC,
+	PRF_BMP,
+	PRF_RAM,
+	PRF_PRF,
+	PRF_LOOP,		// whole superloop pass
+	PRF_NB,
+} prf_module_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+#ifdef USE_PROFILING
+
+// superloop profiling
+extern void PRF_init(void);
+
+extern void PRF_run(void);
+
+// return the current value of the free-running timer
+extern u16 PRF_start(void);
+
+// account the time elapsed since start for the given entry
+extern void PRF_stop(prf_module_t mod, u16 start);
+
+// static RAM used by the module
+extern u16 PRF_ram(void);
+
+// measure the duration of a module run function
+# define PRF_RUN(mod, run)	do { u16 _prf = PRF_start(); run(); PRF_stop((mod), _prf); } while (0)
+
+#else
+
+# define PRF_init()
+# define PRF_run()
+# define PRF_start()		0
+# define PRF_stop(mod, start)	(void)(start)
+# define PRF_RUN(mod, run)	run()
+
+#endif
+
+#endif	// __PROF_H__
@@ -0,0 +1,260 @@
+#include "ram.h"
+
+#include "minut.h"
+#include "servo.h"
+#include "mpu6050.h"
+#include "tk-off.h"
+#include "sc18is600.h"
+#include "prof.h"
+#include "pool.h"
+#include "rec.h"
+#include "tlm.h"
+#include "cfg.h"
+#include "bmp280.h"
+
+#include "dispatcher.h"
+
+#include "utils/pt.h"
+#include "utils/fifo.h"
+
+#include "avr/io.h"
+
+
+// the whole free RAM between the end of .bss and the top of the stack
+// is painted with a canary value before main() is called.
+// the stack deepest use is then found by looking for the first byte
+// above .bss that has been overwritten.
+
+
+// ------------------------------------------
+// private definitions
+//
+
+#define IN_FIFO_SIZE	1
+
+#define STACK_CANARY	0xc5
+
+#define RAM_STACK		0x00	// stack deepest use
+#define RAM_STATIC		0x01	// total static RAM (.data + .bss)
+#define RAM_MODULE		0x02	// static RAM of one module
+
+
+// ------------------------------------------
+// private variables
+//
+
+// provided by the linker
+extern u8 __data_start;
+extern u8 _end;
+extern u8 __stack;
+
+struct {
+	pt_t pt;					// pt for the command thread
+	dpt_interface_t interf;		// interface to the dispatcher
+
+	frame_t in_buf[IN_FIFO_SIZE];
+	fifo_t in_fifo;
+
+	frame_t fr;					// command frame
+} RAM;
+
+
+// ------------------------------------------
+// private functions
+//
+
+// paint the stack before the C runtime sets it up
+void RAM_paint(void) __attribute__ ((naked, used, section(".init1")));
+
+void RAM_paint(void)
+{
+	// no C code can run here as r1 is not yet cleared
+	__asm volatile (
+		"	ldi r30, lo8(_end)\n"
+		"	ldi r31, hi8(_end)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:\n"
+		"	st Z+, r24\n"
+		"2:\n"
+		"	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "i" (STACK_CANARY)
+	);
+}
+
+
+// count the bytes never written since reset
+static u16 RAM_untouched(void)
+{
+	const u8* p = &_end;
+	u16 nb = 0;
+
+	while ( p <= &__stack && *p == STACK_CANARY ) {
+		p++;
+		nb++;
+	}
+
+	return nb;
+}
+
+
+static u16 RAM_module(u8 mod)
+{
+	switch (mod) {
+	case RAM_MNT:
+		return MNT_ram();
+
+	case RAM_SRV:
+		return SRV_ram();
+
+	case RAM_MPU:
+		return MPU_ram();
+
+	case RAM_TKF:
+		return TKF_ram();
+
+	case RAM_SC18:
+		return SC18IS600_ram();
+
+	case RAM_PRF:
+#ifdef USE_PROFILING
+		return PRF_ram();
+#else
+		return 0;
+#endif
+
+	case RAM_POOL:
+		return POOL_ram();
+
+	case RAM_REC:
+		return REC_ram();
+
+	case RAM_TLM:
+#ifdef USE_TELEMETRY
+		return TLM_ram();
+#else
+		return 0;
+#endif
+
+	case RAM_CFG:
+		return CFG_ram();
+
+	case RAM_BMP:
+#ifdef USE_BMP280
+		return BMP_ram();
+#else
+		return 0;
+#endif
+
+	case RAM_RAM:
+		return sizeof(RAM);
+
+	default:
+		return 0;
+	}
+}
+
+
+static void RAM_read(frame_t* fr)
+{
+	u16 val;
+	u16 stack;
+
+	switch ( fr->argv[0] ) {
+	case RAM_STACK:
+		// deepest use and remaining margin
+		stack = &__stack - &_end + 1;
+		val = RAM_untouched();
+
+		fr->argv[1] = ((stack - val) & 0xff00) >> 8;
+		fr->argv[2] = ((stack - val) & 0x00ff) >> 0;
+		fr->argv[3] = (val & 0xff00) >> 8;
+		fr->argv[4] = (val & 0x00ff) >> 0;
+		break;
+
+	case RAM_STATIC:
+		val = &_end - &__data_start;
+
+		fr->argv[1] = (val & 0xff00) >> 8;
+		fr->argv[2] = (val & 0x00ff) >> 0;
+		break;
+
+	case RAM_MODULE:
+		if ( fr->argv[1] >= RAM_NB ) {
+			fr->error = 1;
+			break;
+		}
+
+		val = RAM_module(fr->argv[1]);
+
+		fr->argv[2] = (val & 0xff00) >> 8;
+		fr->argv[3] = (val & 0x00ff) >> 0;
+		break;
+
+	default:
+		// bad sub-command
+		fr->error = 1;
+		break;
+	}
+}
+
+
+static PT_THREAD( RAM_thread(pt_t* pt) )
+{
+	u8 swap;
+
+	PT_BEGIN(pt);
+
+	// wait incoming commands
+	PT_WAIT_UNTIL(pt, OK == FIFO_get(&RAM.in_fifo, &RAM.fr));
+
+	// responses are ignored
+	if ( RAM.fr.resp ) {
+		DPT_unlock(&RAM.interf);
+		PT_RESTART(pt);
+	}
+
+	RAM.fr.error = 0;
+	RAM_read(&RAM.fr);
+
+	// send the response
+	swap = RAM.fr.orig;
+	RAM.fr.orig = RAM.fr.dest;
+	RAM.fr.dest = swap;
+	RAM.fr.resp = 1;
+
+	DPT_lock(&RAM.interf);
+	PT_WAIT_UNTIL(pt, OK == DPT_tx(&RAM.interf, &RAM.fr));
+	DPT_unlock(&RAM.interf);
+
+	PT_RESTART(pt);
+
+	PT_END(pt);
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void RAM_init(void)
+{
+	FIFO_init(&RAM.in_fifo, &RAM.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
+
+	RAM.interf.channel = 12;
+	RAM.interf.cmde_mask = _CM(FR_MINUT_RAM);
+	RAM.interf.queue = &RAM.in_fifo;
+	DPT_register(&RAM.interf);
+
+	PT_INIT(&RAM.pt);
+}
+
+
+void RAM_run(void)
+{
+	(void)PT_SCHEDULE(RAM_thread(&RAM.pt));
+}
@@ -0,0 +1,37 @@
+#ifndef __RAM_H__
+# define __RAM_H__
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// modules whose static RAM is reported
+// the order is the one used by the FR_MINUT_RAM frame
+typedef enum {
+	RAM_MNT,
+	RAM_SRV,
+	RAM_MPU,
+	RAM_TKF,
+	RAM_SC18,
+	RAM_PRF,
+	RAM_POOL,
+	RAM_REC,
+	RAM_TLM,
+	RAM_CFG,
+	RAM_BMP,
+	RAM_RAM,
+	RAM_NB,
+} ram_module_t;
+
+
+// ------------------------------------------
+// public functions
+//
+
+// stack and RAM usage reporting
+extern void RAM_init(void);
+
+extern void RAM_run(void);
+
+#endif	// __RAM_H__
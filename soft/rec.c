@@ -0,0 +1,478 @@
+#include "rec.h"
+
+#include "dispatcher.h"
+
+#include "utils/pt.h"
+#include "utils/fifo.h"
+#include "utils/time.h"
+
+#include "avr/io.h"
+#include "avr/interrupt.h"
+
+
+// ------------------------------------------
+// private definitions
+//
+
+#define IN_FIFO_SIZE	3
+
+#define REC_ACC_PERIOD	(100 * TIME_1_MSEC)		// acceleration recording period, until the deployment
+#define REC_GYR_PERIOD	(200 * TIME_1_MSEC)		// rotation recording period, until the deployment
+#define REC_DESCENT_PERIOD	(2000 * TIME_1_MSEC)	// acceleration recording period from the deployment
+#define REC_PRE_TRIGGER	10		// pre-trigger window [REC_ACC_PERIOD], covers the take-off detection delay
+#define REC_RING_NB		(REC_PRE_TRIGGER * 3 / 2 + 4)	// staging ring entries : both sample types and a few states
+#define REC_WR_SIZE		32		// EEPROM writer buffer size, a power of 2
+#define REC_LEN_UPDATE	32		// maximum bytes written before the length is updated
+#define REC_ENTRY_MAX	(1 + 3 + 3 * 3)		// longest encoded entry
+
+#define REC_INFO		0x00	// record length and lost entries
+#define REC_READ		0x01	// record bytes
+
+
+// ------------------------------------------
+// private types
+//
+
+typedef struct {
+	u8 type;		// entry type
+	u32 time;		// reception time
+	s16 val[3];		// sample axes or state / event in val[0]
+} rec_entry_t;
+
+
+// ------------------------------------------
+// private variables
+//
+
+// provided by the linker, end of the EEPROM frames
+extern u8 __eeprom_end;
+
+struct {
+	pt_t pt;					// pt for the frames thread
+	dpt_interface_t interf;		// interface to the dispatcher
+
+	frame_t in_buf[IN_FIFO_SIZE];
+	fifo_t in_fifo;
+
+	frame_t fr;					// incoming frame
+
+	// staging ring
+	rec_entry_t ring[REC_RING_NB];
+	u8 ring_in;					// next free entry
+	u8 ring_nb;					// used entries
+
+	u32 sampled[2];				// time of the last staged sample of each type
+	u32 period[2];				// recording period of each type, 0 if not recorded
+	u8 triggered;				// take-off received, the record is being written
+	u16 dropped;				// entries lost
+
+	// encoder
+	u32 enc_time;				// time of the last encoded entry
+	s16 prev[2][3];				// last encoded sample of each type
+	u16 queued;					// bytes given to the writer
+
+	// EEPROM writer
+	u8 wr_buf[REC_WR_SIZE];
+	volatile u8 wr_in;			// free-running indexes
+	volatile u8 wr_out;
+	u16 start;					// EEPROM address of the record
+	volatile u16 len;			// bytes written after the length
+	volatile u16 saved;			// length value written in EEPROM
+	volatile u8 hdr;			// length bytes still to write
+} REC;
+
+
+// ------------------------------------------
+// private functions
+//
+
+// EEPROM background writer
+ISR(EE_READY_vect)
+{
+	u16 addr;
+	u8 data;
+
+	// the length is updated once the buffer is empty and periodically meanwhile
+	if ( ! REC.hdr && REC.saved != REC.len
+			&& ( REC.wr_out == REC.wr_in || REC.len - REC.saved >= REC_LEN_UPDATE ) ) {
+		REC.hdr = 2;
+		REC.saved = REC.len;
+	}
+
+	if ( REC.hdr ) {
+		// length MSB first
+		REC.hdr--;
+		addr = REC.start + 1 - REC.hdr;
+		data = REC.hdr ? (REC.saved & 0xff00) >> 8 : (REC.saved & 0x00ff) >> 0;
+	}
+	else if ( REC.wr_out != REC.wr_in ) {
+		addr = REC.start + 2 + REC.len;
+		data = REC.wr_buf[REC.wr_out & (REC_WR_SIZE - 1)];
+		REC.wr_out++;
+		REC.len++;
+	}
+	else {
+		// nothing more to write
+		EECR &= ~_BV(EERIE);
+		return;
+	}
+
+	EEAR = addr;
+	EEDR = data;
+	EECR |= _BV(EEMPE);
+	EECR |= _BV(EEPE);
+}
+
+
+static u8 REC_eeprom_read(u16 addr)
+{
+	EEAR = addr;
+	EECR |= _BV(EERE);
+
+	return EEDR;
+}
+
+
+// stage an entry in the ring
+static void REC_stage(u8 type, s16 v0, s16 v1, s16 v2)
+{
+	rec_entry_t* e;
+
+	if ( REC.ring_nb == REC_RING_NB ) {
+		// once triggered, nothing shall be lost silently
+		if ( REC.triggered ) {
+			REC.dropped++;
+			return;
+		}
+
+		// else the oldest entry is forgotten
+		REC.ring_nb--;
+	}
+
+	e = &REC.ring[REC.ring_in];
+	e->type = type;
+	e->time = TIME_get();
+	e->val[0] = v0;
+	e->val[1] = v1;
+	e->val[2] = v2;
+
+	REC.ring_in++;
+	if ( REC.ring_in >= REC_RING_NB ) {
+		REC.ring_in = 0;
+	}
+	REC.ring_nb++;
+}
+
+
+static void REC_sample(u8 type, frame_t* fr)
+{
+	u32 now = TIME_get();
+
+	// the samples are recorded at a lower rate than published
+	if ( REC.period[type] == 0 || now - REC.sampled[type] < REC.period[type] ) {
+		return;
+	}
+	REC.sampled[type] = now;
+
+	REC_stage(type, (fr->argv[0] << 8) | fr->argv[1], (fr->argv[2] << 8) | fr->argv[3], (fr->argv[4] << 8) | fr->argv[5]);
+}
+
+
+static rec_entry_t* REC_oldest(void)
+{
+	u8 i = REC.ring_in + REC_RING_NB - REC.ring_nb;
+
+	if ( i >= REC_RING_NB ) {
+		i -= REC_RING_NB;
+	}
+
+	return &REC.ring[i];
+}
+
+
+static void REC_trigger(void)
+{
+	u8 i;
+
+	// staged before triggering, so the oldest pre-trigger entry
+	// makes room for it when the ring is full
+	REC_stage(REC_EVENT, REC_EV_TAKE_OFF, 0, 0);
+
+	// forget the previous record
+	REC.len = 0;
+	REC.saved = 0;
+	REC.hdr = 2;
+	REC.queued = 0;
+
+	// the encoding starts from the oldest staged entry
+	REC.enc_time = REC.ring_nb ? REC_oldest()->time : TIME_get();
+	for (i = 0; i < 3; i++) {
+		REC.prev[REC_ACC][i] = 0;
+		REC.prev[REC_GYR][i] = 0;
+	}
+
+	REC.triggered = 1;
+
+	EECR |= _BV(EERIE);
+}
+
+
+static u8 REC_varint(u8* p, u16 v)
+{
+	u8 n = 0;
+
+	while ( v >= 0x80 ) {
+		p[n++] = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	p[n++] = v;
+
+	return n;
+}
+
+
+// encode an entry, return its length
+static u8 REC_encode(rec_entry_t* e, u8* p)
+{
+	u32 dt;
+	s16 d;
+	u8 n = 0;
+	u8 i;
+
+	p[n++] = e->type;
+
+	dt = (e->time - REC.enc_time) / TIME_1_MSEC;
+	n += REC_varint(p + n, dt > 0xffff ? 0xffff : dt);
+
+	switch ( e->type ) {
+	case REC_ACC:
+	case REC_GYR:
+		for (i = 0; i < 3; i++) {
+			// zigzag encoding so small negative deltas stay short
+			d = e->val[i] - REC.prev[e->type][i];
+			n += REC_varint(p + n, ((u16)d << 1) ^ (u16)(d >> 15));
+		}
+		break;
+
+	default:
+		p[n++] = e->val[0];
+		break;
+	}
+
+	return n;
+}
+
+
+// move the staged entries to the writer as long as there is room
+static void REC_flush(void)
+{
+	u8 buf[REC_ENTRY_MAX];
+	rec_entry_t* e;
+	u8 n;
+	u8 i;
+	u8 added = 0;
+
+	while ( REC.ring_nb ) {
+		e = REC_oldest();
+		n = REC_encode(e, buf);
+
+		// wait for the writer
+		if ( REC_WR_SIZE - (u8)(REC.wr_in - REC.wr_out) < n ) {
+			break;
+		}
+
+		// the EEPROM is full
+		if ( REC.start + 2 + REC.queued + n > E2END + 1 ) {
+			REC.dropped++;
+		}
+		else {
+			for (i = 0; i < n; i++) {
+				REC.wr_buf[(REC.wr_in + i) & (REC_WR_SIZE - 1)] = buf[i];
+			}
+			REC.wr_in += n;
+			REC.queued += n;
+			added = 1;
+
+			// the encoder state follows the entries given to the writer
+			REC.enc_time = e->time;
+			if ( e->type == REC_ACC || e->type == REC_GYR ) {
+				for (i = 0; i < 3; i++) {
+					REC.prev[e->type][i] = e->val[i];
+				}
+			}
+		}
+
+		REC.ring_nb--;
+	}
+
+	// (re)start the writer
+	if ( added ) {
+		EECR |= _BV(EERIE);
+	}
+}
+
+
+static void REC_dump(frame_t* fr)
+{
+	u16 len;
+	u16 offset;
+	u8 i;
+
+	// the EEPROM can't be read while it is written
+	if ( EECR & _BV(EERIE) ) {
+		fr->error = 1;
+		return;
+	}
+
+	// the length in EEPROM is the one of the last record, maybe from a previous power-up
+	len = REC_eeprom_read(REC.start) << 8;
+	len |= REC_eeprom_read(REC.start + 1);
+	if ( len > E2END + 1 - REC.start - 2 ) {
+		len = 0;
+	}
+
+	switch ( fr->argv[0] ) {
+	case REC_INFO:
+		fr->argv[1] = (len & 0xff00) >> 8;
+		fr->argv[2] = (len & 0x00ff) >> 0;
+		fr->argv[3] = (REC.dropped & 0xff00) >> 8;
+		fr->argv[4] = (REC.dropped & 0x00ff) >> 0;
+		break;
+
+	case REC_READ:
+		offset = (fr->argv[1] << 8) | fr->argv[2];
+		if ( offset >= len ) {
+			fr->error = 1;
+			break;
+		}
+
+		// up to 3 bytes, the missing ones read as 0xff
+		for (i = 0; i < 3; i++) {
+			fr->argv[3 + i] = offset + i < len ? REC_eeprom_read(REC.start + 2 + offset + i) : 0xff;
+		}
+		break;
+
+	default:
+		// bad sub-command
+		fr->error = 1;
+		break;
+	}
+}
+
+
+static PT_THREAD( REC_thread(pt_t* pt) )
+{
+	u8 swap;
+
+	PT_BEGIN(pt);
+
+	// wait incoming frames
+	PT_WAIT_UNTIL(pt, OK == FIFO_get(&REC.in_fifo, &REC.fr));
+
+	// responses are ignored
+	if ( REC.fr.resp ) {
+		DPT_unlock(&REC.interf);
+		PT_RESTART(pt);
+	}
+
+	switch ( REC.fr.cmde ) {
+	case FR_DATA_ACC:
+		REC_sample(REC_ACC, &REC.fr);
+		PT_RESTART(pt);
+
+	case FR_DATA_GYR:
+		REC_sample(REC_GYR, &REC.fr);
+		PT_RESTART(pt);
+
+	case FR_MINUT_BATCH:
+		if ( REC.fr.argv[0] != FR_BATCH_KEEP ) {
+			REC_stage(REC_STATE, REC.fr.argv[0], 0, 0);
+		}
+
+		// under the cone or the parachute, the acceleration
+		// at a slow pace is enough, so the record lasts the whole descent
+		if ( REC.fr.argv[0] == FR_STATE_CONE_OPEN ) {
+			REC.period[REC_ACC] = REC_DESCENT_PERIOD;
+			REC.period[REC_GYR] = 0;
+		}
+		PT_RESTART(pt);
+
+	case FR_TAKE_OFF:
+		// the take-off frame is repeated until acknowledged
+		if ( ! REC.triggered ) {
+			REC_trigger();
+		}
+		PT_RESTART(pt);
+
+	case FR_MINUT_RECORD:
+		REC.fr.error = 0;
+		REC_dump(&REC.fr);
+		break;
+
+	default:
+		PT_RESTART(pt);
+	}
+
+	// send the response
+	swap = REC.fr.orig;
+	REC.fr.orig = REC.fr.dest;
+	REC.fr.dest = swap;
+	REC.fr.resp = 1;
+
+	DPT_lock(&REC.interf);
+	PT_WAIT_UNTIL(pt, OK == DPT_tx(&REC.interf, &REC.fr));
+	DPT_unlock(&REC.interf);
+
+	PT_RESTART(pt);
+
+	PT_END(pt);
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void REC_init(void)
+{
+	FIFO_init(&REC.in_fifo, &REC.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
+
+	REC.interf.channel = 13;
+	REC.interf.cmde_mask = _CM(FR_DATA_ACC) | _CM(FR_DATA_GYR) | _CM(FR_MINUT_BATCH) | _CM(FR_TAKE_OFF) | _CM(FR_MINUT_RECORD);
+	REC.interf.queue = &REC.in_fifo;
+	DPT_register(&REC.interf);
+
+	// the record follows the EEPROM frames
+	REC.start = (u16)&__eeprom_end;
+
+	REC.ring_in = 0;
+	REC.ring_nb = 0;
+	REC.triggered = 0;
+	REC.dropped = 0;
+
+	REC.period[REC_ACC] = REC_ACC_PERIOD;
+	REC.period[REC_GYR] = REC_GYR_PERIOD;
+
+	REC.wr_in = 0;
+	REC.wr_out = 0;
+	REC.hdr = 0;
+
+	PT_INIT(&REC.pt);
+}
+
+
+void REC_run(void)
+{
+	(void)PT_SCHEDULE(REC_thread(&REC.pt));
+
+	// the record is written from the take-off
+	if ( REC.triggered ) {
+		REC_flush();
+	}
+}
+
+
+u16 REC_ram(void)
+{
+	return sizeof(REC);
+}
@@ -0,0 +1,62 @@
+#ifndef __REC_H__
+# define __REC_H__
+
+# include "type_def.h"
+
+
+// flight data recorder
+//
+// the IMU samples, the state transitions and the take-off event
+// are time stamped and staged in a RAM ring.
+// until the deployment, the acceleration is recorded every 100 ms
+// and the rotation every 200 ms. from the deployment, only the acceleration
+// is recorded, every 2 s.
+// until the take-off, the ring keeps the latest entries (pre-trigger window).
+// from the take-off, the entries are encoded and written to the internal
+// EEPROM by an EE_READY interrupt-driven writer, after the EEPROM frames.
+//
+// the record starts with its length (2 bytes, MSB first) followed by
+// the encoded entries :
+//	- 1 tag byte : entry type (REC_ACC, REC_GYR, REC_STATE or REC_EVENT)
+//	- the time elapsed since the previous entry [ms], as a varint
+//	- for samples : the 3 axes as zigzag varint deltas from the previous
+//	  sample of the same type
+//	- for states and events : 1 byte
+// a varint is made of 7-bit groups, LSB first, the MSB of a byte
+// telling another group follows.
+//
+// with about 980 bytes of EEPROM after the frames, the record holds
+// the 1 s pre-trigger window and about 5 s up to the deployment (~125 bytes/s),
+// then about 1 min of descent (~4 bytes/s).
+//
+// the record is dumped with the FR_MINUT_RECORD frame.
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// entry types
+typedef enum {
+	REC_ACC,
+	REC_GYR,
+	REC_STATE,
+	REC_EVENT,
+} rec_type_t;
+
+// event values
+#define REC_EV_TAKE_OFF		0x01
+
+
+// ------------------------------------------
+// public functions
+//
+
+extern void REC_init(void);
+
+extern void REC_run(void);
+
+// static RAM used by the module
+extern u16 REC_ram(void);
+
+#endif	// __REC_H__
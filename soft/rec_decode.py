@@ -0,0 +1,76 @@
+#!/usr/bin/python
+
+# decode a flight record
+#
+# the input file holds the record bytes as dumped by the
+# FR_MINUT_RECORD frame, the length excluded,
+# as hexadecimal values separated by blanks.
+#
+# see rec.h for the encoding.
+#
+
+import sys
+
+
+ACC = 0
+GYR = 1
+STATE = 2
+EVENT = 3
+
+names = { ACC: 'acc', GYR: 'gyr', STATE: 'state', EVENT: 'event' }
+
+
+def varint(data, i):
+	"""return the varint value at index i and the next index"""
+	val = 0
+	shift = 0
+	while True:
+		b = data[i]
+		i += 1
+		val |= (b & 0x7f) << shift
+		shift += 7
+		if not b & 0x80:
+			return val, i
+
+
+def s16(v):
+	"""16-bit two's complement value"""
+	v &= 0xffff
+	return v - 0x10000 if v & 0x8000 else v
+
+
+def decode(data):
+	"""yield (time [ms], type name, values) for each entry"""
+	prev = { ACC: [0, 0, 0], GYR: [0, 0, 0] }
+	t = 0
+	i = 0
+	while i < len(data):
+		typ = data[i]
+		dt, i = varint(data, i + 1)
+		t += dt
+
+		if typ in (ACC, GYR):
+			vals = []
+			for axis in range(3):
+				z, i = varint(data, i)
+				d = (z >> 1) ^ -(z & 1)
+				prev[typ][axis] = s16(prev[typ][axis] + d)
+				vals.append(prev[typ][axis])
+
+		elif typ in (STATE, EVENT):
+			vals = [data[i]]
+			i += 1
+
+		else:
+			raise Exception("bad entry type 0x%02x at offset %d" % (typ, i - 1))
+
+		yield t, names[typ], vals
+
+
+#----------------------------
+# main
+if __name__ == '__main__':
+	data = [int(x, 16) for x in open(sys.argv[1]).read().split()]
+
+	for t, name, vals in decode(data):
+		print("%8d ms  %-5s %s" % (t, name, ' '.join('%6d' % v for v in vals)))
@@ -33,6 +33,7 @@
 #include "drivers/spi.h"
 
 #include "utils/pt.h"
+#include "utils/time.h"
 
 #include <string.h>		// memcpy()
 
@@ -52,6 +53,9 @@
 
 #define SC18_BUF_SIZE	16
 
+// longest I2C transaction (a full buffer at 97 kHz) with margin
+#define SC18_TIME_OUT	(5 * TIME_1_MSEC)
+
 
 //-----------------------------------------------------
 // private types
@@ -64,9 +68,15 @@
 
 static struct {
 	pt_t pt;
+	pt_t pt_wait;
 
 	u8 tx[SC18_BUF_SIZE];
 	u8 rx[SC18_BUF_SIZE];
+
+	struct i2c_stat_t stat;		// status of the last I2C transaction
+	u32 time_out;				// end of the wait for the status
+
+	u8 locked;
 } SC18;
 
 
@@ -110,6 +120,26 @@ static PT_THREAD( SC18IS600_reg_get(pt_t* pt, u8 offset, u8* reg) )
 }
 
 
+// wait for the end of the I2C transaction
+// a NACK or a transaction lasting too long ends it,
+// the outcome is left in SC18.stat
+static PT_THREAD( SC18IS600_wait(pt_t* pt) )
+{
+	PT_BEGIN(pt);
+
+	SC18.time_out = TIME_get() + SC18_TIME_OUT;
+	do {
+		PT_SPAWN(pt, &SC18.pt, SC18IS600_reg_get(&SC18.pt, SC18_OFFSET(i2c_stat), (u8*)&SC18.stat) );
+
+		if ( TIME_get() >= SC18.time_out ) {
+			SC18.stat.stat = SC18_TIMEOUT;
+		}
+	} while (SC18.stat.stat == SC18_BUS_BUSY);
+
+	PT_END(pt);
+}
+
+
 //-----------------------------------------------------
 // public functions
 //
@@ -161,6 +191,12 @@ PT_THREAD( SC18IS600_tx(pt_t* pt, u8 addr, u8* data, u8* n) )
 
 	PT_WAIT_UNTIL(pt, SPI_is_fini());
 
+	// check the data was sent
+	PT_SPAWN(pt, &SC18.pt_wait, SC18IS600_wait(&SC18.pt_wait));
+	if ( SC18.stat.stat != SC18_TR_SUCCESS ) {
+		*n = 0;
+	}
+
 	PT_END(pt);
 }
 
@@ -184,10 +220,11 @@ PT_THREAD( SC18IS600_rx(pt_t* pt, u8 addr, u8* data, u8* n) )
 	PT_WAIT_UNTIL(pt, SPI_is_fini());
 
 	// check data was received
-	struct i2c_stat_t i2c_stat;
-	do {
-		PT_SPAWN(pt, &SC18.pt, SC18IS600_reg_get(&SC18.pt, SC18_OFFSET(i2c_stat), (u8*)&i2c_stat) );
-	} while (i2c_stat.stat != SC18_TR_SUCCESS);
+	PT_SPAWN(pt, &SC18.pt_wait, SC18IS600_wait(&SC18.pt_wait));
+	if ( SC18.stat.stat != SC18_TR_SUCCESS ) {
+		*n = 0;
+		PT_EXIT(pt);
+	}
 
 	// retreive data
 	SC18.tx[0] = SC18_RD_BUF;
@@ -202,3 +239,26 @@ PT_THREAD( SC18IS600_rx(pt_t* pt, u8 addr, u8* data, u8* n) )
 }
 
 
+u8 SC18IS600_lock(void)
+{
+	if ( SC18.locked ) {
+		return KO;
+	}
+
+	SC18.locked = 1;
+
+	return OK;
+}
+
+
+void SC18IS600_unlock(void)
+{
+	SC18.locked = 0;
+}
+
+
+// static RAM used by the driver
+u16 SC18IS600_ram(void)
+{
+	return sizeof(SC18);
+}
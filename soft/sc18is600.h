@@ -32,6 +32,13 @@
 // read n data from I2C addr
 // sc18is600_rx(addr, data, n)
 //
+// on return, n holds the number of data transferred,
+// 0 if the I2C device did not acknowledge or if the bridge timed out
+//
+// several modules share the bridge,
+// each transaction sequence shall be bracketed by
+// sc18is600_lock() and sc18is600_unlock()
+//
 
 #ifndef __SC18IS600_H__
 # define __SC18IS600_H__
@@ -55,9 +62,21 @@ extern PT_THREAD( SC18IS600_init(pt_t* pt));
 
 
 // send n data to I2C addr
+// n is set to 0 on error
 extern PT_THREAD( SC18IS600_tx(pt_t* pt, u8 addr, u8* data, u8* n));
 
 // read n data from I2C addr
+// n is set to 0 on error
 extern PT_THREAD( SC18IS600_rx(pt_t* pt, u8 addr, u8* data, u8* n));
 
+// take the bridge for a transaction sequence
+// return OK if it was free
+extern u8 SC18IS600_lock(void);
+
+// release the bridge
+extern void SC18IS600_unlock(void);
+
+// static RAM used by the driver
+extern u16 SC18IS600_ram(void);
+
 #endif	// __SC18IS600_H__
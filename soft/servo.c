@@ -1,4 +1,7 @@
 #include "servo.h"
+#include "pool.h"
+#include "cfg.h"
+#include "mark.h"
 
 #include "dispatcher.h"
 
@@ -8,6 +11,28 @@
 #include "utils/time.h"
 
 #include "avr/io.h"
+#include "avr/interrupt.h"
+
+
+// the servo signals are generated by TIMER1 in fast PWM mode :
+// prescaler 8 @ 16 MHz so 1 tick = 0.5 us, and a period of 20 ms.
+//
+// the motion of each servo follows a profile run from the TIMER1
+// overflow interrupt, so once every period :
+//	- the compare value moves toward the target by at most the slew rate,
+//	- once the target is reached, the servo is kept powered for the hold time
+//	  then switched off automatically.
+// a slew rate of 0 means an immediate move, a hold time of 0 means no auto-off.
+// a servo switched off is assumed to stay where it was last driven
+// (at neutral after reset), so the move restarting it is slew limited too.
+//
+// the same interrupt counts down the backup deployment armed at take-off :
+// when it elapses, the cone is driven open straight from the interrupt,
+// so the deployment doesn't depend on the superloop being scheduled.
+//
+// when both servos are steady and the backup is disarmed, the interrupt
+// has nothing to do. it can then be masked while the AVR sleeps,
+// the PWM being generated by the hardware alone (see SRV_sleep()).
 
 
 // ------------------------------------------
@@ -23,6 +48,40 @@
 #define SERVO_CONE	_BV(PB1)
 #define SERVO_AERO	_BV(PB2)
 
+#define SERVO_PERIODS_PER_100MS	5	// number of 20 ms PWM periods in 100 ms
+
+#define SERVO_NEUTRAL_CMP	3000	// compare value of the 0 degree position
+
+#define SERVO_STAMP_NONE	0	// no move to time stamp
+#define SERVO_STAMP_WAIT	1	// waiting for the PWM change
+#define SERVO_STAMP_TAKE	2	// PWM changed, time stamp to be taken
+
+
+// ------------------------------------------
+// private types
+//
+
+typedef struct {
+	s8 open_pos;		// open position [degree]
+	s8 close_pos;		// closed position [degree]
+	u8 slew;			// maximum slew rate [degree / 20 ms]
+	u8 hold;			// hold time before auto-off [100 ms]
+
+	// precomputed when the configuration is saved, read by the interrupt
+	u16 open_cmp;		// open position compare value
+	u16 close_cmp;		// closed position compare value
+	u16 slew_cmp;		// maximum compare change per period
+
+	// motion profile, shared with the interrupt
+	volatile u16 cmp;		// current compare value, 0 when off
+	volatile u16 last;		// last compare value driven, 0 if never
+	volatile u16 target;	// target compare value
+	volatile u16 hold_cnt;	// remaining periods before auto-off
+	volatile u8 stamp;		// time stamp of the move requested, then to be taken
+
+	u32 moved;			// time of the last PWM change toward a new target
+} srv_servo_t;
+
 
 // ------------------------------------------
 // private variables
@@ -34,27 +93,21 @@ struct {
 
 	dpt_interface_t interf;	// interface to the dispatcher
 
-	struct {
-		s8 open_pos;		// open position
-		s8 close_pos;		// closed position
-	} cone;
-
-	struct {
-		s8 open_pos;		// open position
-		s8 close_pos;		// closed position
-	} aero;
+	srv_servo_t cone;
+	srv_servo_t aero;
 
 	// incoming frames fifo
 	fifo_t in;
 	frame_t in_buf[IN_FIFO_SIZE];
 
-	// outgoing frames fifo
-	fifo_t out;
-	frame_t out_buf[OUT_FIFO_SIZE];
+	// outgoing frames handles fifo
+	pool_fifo_t out;
+	pool_hdl_t out_buf[OUT_FIFO_SIZE];
 
-	frame_t out_fr;	// frame for the sending thread
-	frame_t in_fr;	// frame for the cmde thread
+	pool_hdl_t in_hdl;	// frame for the cmde thread
 
+	volatile u16 backup;		// periods before the backup deployment, 0 when disarmed
+	volatile u8 backup_fired;	// the backup deployment has driven the cone
 } SRV;
 
 
@@ -62,162 +115,241 @@ struct {
 // private functions
 //
 
-// activate the cone servo to drive it to the given position
-static void SRV_cone_on(s8 position)
+// compute the compare value according to the required position and the prescaler
+static u16 SRV_compare(s8 position)
 {
-	// compute the compare value according to the required position and the prescaler
 	// for position = -90 degrees, signal up time shall be 1 ms so compare = 2000
 	// for position = 0 degrees, signal up time shall be 1.5 ms so compare = 3000
 	// for position = +90 degrees, signal up time shall be 2 ms so compare = 4000
 	// compare = (position / 90) * 1000 + 3000
 	// the computation shall be modified to fit in s16
 	// the result is sure to fit in u16
-	TMR1_compare_set(TMR1_A, ((s16)position * 100 / 9) + 3000);
+	return ((s16)position * 100 / 9) + 3000;
 }
 
 
-// deactivate the cone servo to save power
-static void SRV_cone_off(void)
+// update the precomputed values after a configuration change
+static void SRV_precompute(srv_servo_t* srv)
 {
-	// setting the compare value to 0, ensure output pin is driven lo
-	TMR1_compare_set(TMR1_A, 0);
+	u16 open_cmp = SRV_compare(srv->open_pos);
+	u16 close_cmp = SRV_compare(srv->close_pos);
+	u16 slew_cmp = (u16)srv->slew * 100 / 9;
+	u8 sreg = SREG;
+
+	// the backup deployment and the motion profile read them from the interrupt
+	cli();
+	srv->open_cmp = open_cmp;
+	srv->close_cmp = close_cmp;
+	srv->slew_cmp = slew_cmp;
+	SREG = sreg;
 }
 
 
-// activate the aero servo to drive it to the given position
-static void SRV_aero_on(s8 position)
+// one step of the motion profile of a servo
+static void SRV_step(srv_servo_t* srv, tmr1_compare_t comp)
 {
-	// compute the compare value according to the required position and the prescaler
-	// for position = -90 degrees, signal up time shall be 1 ms so compare = 2000
-	// for position = 0 degrees, signal up time shall be 1.5 ms so compare = 3000
-	// for position = +90 degrees, signal up time shall be 2 ms so compare = 4000
-	// compare = (position / 90) * 1000 + 3000
-	// the computation shall be modified to fit in s16
-	// the result is sure to fit in u16
-	TMR1_compare_set(TMR1_B, ((s16)position * 100 / 9) + 3000);
-}
+	// servo off
+	if ( srv->target == 0 ) {
+		return;
+	}
 
+	// move toward the target
+	if ( srv->cmp != srv->target ) {
+		// starting from off, restart from the last driven position
+		if ( srv->cmp == 0 ) {
+			srv->cmp = srv->last ? srv->last : SERVO_NEUTRAL_CMP;
+		}
 
-// deactivate the aero servo to save power
-static void SRV_aero_off(void)
-{
-	// setting the compare value to 0, ensure output pin is driven lo
-	TMR1_compare_set(TMR1_B, 0);
-}
+		if ( srv->slew_cmp == 0 ) {
+			srv->cmp = srv->target;
+		}
+		else if ( srv->cmp < srv->target ) {
+			if ( srv->target - srv->cmp > srv->slew_cmp ) {
+				srv->cmp += srv->slew_cmp;
+			}
+			else {
+				srv->cmp = srv->target;
+			}
+		}
+		else {
+			if ( srv->cmp - srv->target > srv->slew_cmp ) {
+				srv->cmp -= srv->slew_cmp;
+			}
+			else {
+				srv->cmp = srv->target;
+			}
+		}
 
+		TMR1_compare_set(comp, srv->cmp);
+		srv->last = srv->cmp;
 
-static void SRV_drive(u8 servo, u8 sense)
-{
-	switch (servo) {
-	case FR_SERVO_CONE:
-		switch (sense) {
-		case FR_SERVO_OPEN:		// open
-			SRV_cone_on(SRV.cone.open_pos);
-			break;
+		// the time is taken outside of the interrupt
+		if ( srv->stamp == SERVO_STAMP_WAIT ) {
+			srv->stamp = SERVO_STAMP_TAKE;
+		}
+		return;
+	}
 
-		case FR_SERVO_CLOSE:	// close
-			SRV_cone_on(SRV.cone.close_pos);
-			break;
+	// target reached, hold it then release the servo
+	if ( srv->hold_cnt ) {
+		srv->hold_cnt--;
 
-		case FR_SERVO_OFF:
-			SRV_cone_off();
-			break;
+		if ( srv->hold_cnt == 0 ) {
+			srv->target = 0;
+			srv->cmp = 0;
 
-		default:
-			break;
+			// setting the compare value to 0, ensure output pin is driven lo
+			TMR1_compare_set(comp, 0);
 		}
-		break;
+	}
+}
 
-	case FR_SERVO_AERO:
-		switch (sense) {
-		case FR_SERVO_OPEN:		// open
-			SRV_aero_on(SRV.aero.open_pos);
-			break;
 
-		case FR_SERVO_CLOSE:	// close
-			SRV_aero_on(SRV.aero.close_pos);
-			break;
+// called from the TIMER1 overflow interrupt, once per PWM period
+static void SRV_tick(void* misc)
+{
+	(void)misc;
+
+	// backup deployment
+	if ( SRV.backup ) {
+		SRV.backup--;
+
+		if ( SRV.backup == 0 ) {
+			if ( SRV.cone.target != SRV.cone.open_cmp ) {
+				SRV.cone.stamp = SERVO_STAMP_WAIT;
+			}
+			SRV.cone.target = SRV.cone.open_cmp;
+			SRV.cone.hold_cnt = (u16)SRV.cone.hold * SERVO_PERIODS_PER_100MS;
+			SRV.backup_fired = 1;
+		}
+	}
 
-		case FR_SERVO_OFF:
-			SRV_aero_off();
-			break;
+	SRV_step(&SRV.cone, TMR1_A);
+	SRV_step(&SRV.aero, TMR1_B);
+}
 
-		default:
-			break;
-		}
-		break;
 
-	default:
-		break;
+// activate the servo to drive it to the given compare value
+static void SRV_on(srv_servo_t* srv, u16 cmp)
+{
+	u8 sreg = SREG;
+
+	// the profile is shared with the interrupt
+	cli();
+	if ( srv->target != cmp ) {
+		srv->stamp = SERVO_STAMP_WAIT;
 	}
+	srv->target = cmp;
+	srv->hold_cnt = (u16)srv->hold * SERVO_PERIODS_PER_100MS;
+	SREG = sreg;
 }
 
 
-static void SRV_cone_save(frame_t* fr)
+// deactivate the servo to save power
+static void SRV_off(srv_servo_t* srv, tmr1_compare_t comp)
 {
-	switch ( fr->argv[2] ) {
-	case FR_SERVO_OPEN:		// open position
-		SRV.cone.open_pos = fr->argv[3];
+	u8 sreg = SREG;
+
+	cli();
+	srv->target = 0;
+	srv->cmp = 0;
+
+	// setting the compare value to 0, ensure output pin is driven lo
+	// the 16-bit register is also written by the interrupt
+	TMR1_compare_set(comp, 0);
+	SREG = sreg;
+}
+
+
+static void SRV_drive(u8 servo, u8 sense)
+{
+	srv_servo_t* srv;
+	tmr1_compare_t comp;
+
+	switch (servo) {
+	case FR_SERVO_CONE:
+		srv = &SRV.cone;
+		comp = TMR1_A;
 		break;
 
-	case FR_SERVO_CLOSE:	// closed position
-		SRV.cone.close_pos = fr->argv[3];
+	case FR_SERVO_AERO:
+		srv = &SRV.aero;
+		comp = TMR1_B;
 		break;
 
 	default:
-		// shall never happen
-		fr->error = 1;
-		break;
+		return;
 	}
-}
 
+	switch (sense) {
+	case FR_SERVO_OPEN:		// open
+		if ( servo == FR_SERVO_CONE ) {
+			MRK(MRK_CONE_OPEN);
+		}
+		SRV_on(srv, srv->open_cmp);
+		break;
 
-static void SRV_cone_read(frame_t* fr)
-{
-	switch ( fr->argv[2] ) {
-	case FR_SERVO_OPEN:		// open position
-		fr->argv[3] = SRV.cone.open_pos;
+	case FR_SERVO_CLOSE:	// close
+		SRV_on(srv, srv->close_cmp);
 		break;
 
-	case FR_SERVO_CLOSE:	// closed position
-		fr->argv[3] = SRV.cone.close_pos;
+	case FR_SERVO_OFF:
+		SRV_off(srv, comp);
 		break;
 
 	default:
-		// shall never happen
-		fr->error = 1;
+		break;
 	}
 }
 
 
-static void SRV_aero_save(frame_t* fr)
+static void SRV_save(srv_servo_t* srv, frame_t* fr)
 {
 	switch ( fr->argv[2] ) {
 	case FR_SERVO_OPEN:		// open position
-		SRV.aero.open_pos = fr->argv[3];
+		srv->open_pos = fr->argv[3];
 		break;
 
 	case FR_SERVO_CLOSE:	// closed position
-		SRV.aero.close_pos = fr->argv[3];
+		srv->close_pos = fr->argv[3];
+		break;
+
+	case FR_SERVO_SLEW:		// maximum slew rate
+		srv->slew = fr->argv[3];
+		break;
+
+	case FR_SERVO_HOLD:		// hold time before auto-off
+		srv->hold = fr->argv[3];
 		break;
 
 	default:
 		// shall never happen
 		fr->error = 1;
-		break;
+		return;
 	}
+
+	// the compare values are not computed again on each drive
+	SRV_precompute(srv);
 }
 
 
-static void SRV_aero_read(frame_t* fr)
+static void SRV_read(srv_servo_t* srv, frame_t* fr)
 {
 	switch ( fr->argv[2] ) {
 	case FR_SERVO_OPEN:		// open position
-		fr->argv[3] = SRV.aero.open_pos;
+		fr->argv[3] = srv->open_pos;
 		break;
 
 	case FR_SERVO_CLOSE:	// closed position
-		fr->argv[3] = SRV.aero.close_pos;
+		fr->argv[3] = srv->close_pos;
+		break;
+
+	case FR_SERVO_SLEW:		// maximum slew rate
+		fr->argv[3] = srv->slew;
+		break;
+
+	case FR_SERVO_HOLD:		// hold time before auto-off
+		fr->argv[3] = srv->hold;
 		break;
 
 	default:
@@ -229,39 +361,30 @@ static void SRV_aero_read(frame_t* fr)
 
 static void SRV_position(frame_t* fr)
 {
+	srv_servo_t* srv;
+
 	switch ( fr->argv[0] ) {
 	case FR_SERVO_CONE:
-		switch ( fr->argv[1] ) {
-		case FR_SERVO_SAVE:	// save
-			SRV_cone_save(fr);
-			break;
-
-		case FR_SERVO_READ:	// read
-			SRV_cone_read(fr);
-			break;
-
-		default:
-			// shall never happen
-			fr->error = 1;
-			break;
-		}
+		srv = &SRV.cone;
 		break;
 
 	case FR_SERVO_AERO:
-		switch ( fr->argv[1] ) {
-		case FR_SERVO_SAVE:	// save
-			SRV_aero_save(fr);
-			break;
+		srv = &SRV.aero;
+		break;
 
-		case FR_SERVO_READ:	// read
-			SRV_aero_read(fr);
-			break;
+	default:
+		// shall never happen
+		fr->error = 1;
+		return;
+	}
 
-		default:
-			// shall never happen
-			fr->error = 1;
-			break;
-		}
+	switch ( fr->argv[1] ) {
+	case FR_SERVO_SAVE:	// save
+		SRV_save(srv, fr);
+		break;
+
+	case FR_SERVO_READ:	// read
+		SRV_read(srv, fr);
 		break;
 
 	default:
@@ -274,16 +397,21 @@ static void SRV_position(frame_t* fr)
 
 static PT_THREAD( SRV_in(pt_t* pt) )
 {
+	frame_t* fr;
 	u8 swap;
 
 	PT_BEGIN(pt);
 
 	// if no incoming frame is available
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&SRV.in, &SRV.in_fr) );
+	PT_WAIT_UNTIL(pt, OK == POOL_get_frame(&SRV.in, &SRV.in_hdl) );
+
+	// the frame is processed in place
+	fr = POOL_frame(SRV.in_hdl);
 
 	// if it is a response
-	if (SRV.in_fr.resp) {
+	if (fr->resp) {
 		// ignore it
+		POOL_release(SRV.in_hdl);
 
 		// release the dispatcher
 		DPT_unlock(&SRV.interf);
@@ -292,31 +420,47 @@ static PT_THREAD( SRV_in(pt_t* pt) )
 		PT_RESTART(pt);
 	}
 
-	SRV.in_fr.error = 0;
+	fr->error = 0;
 
-	switch (SRV.in_fr.cmde) {
+	switch (fr->cmde) {
 		case FR_MINUT_SERVO_CMD:
 			// drive the servo
-			SRV_drive(SRV.in_fr.argv[0], SRV.in_fr.argv[1]);
+			SRV_drive(fr->argv[0], fr->argv[1]);
 			break;
 
 		case FR_MINUT_SERVO_INFO:
-			SRV_position(&SRV.in_fr);
+			SRV_position(fr);
+			break;
+
+		case FR_MINUT_BATCH:
+			// only the servo commands of the batch are for us
+			if ( fr->argv[1] != FR_BATCH_KEEP ) {
+				SRV_drive(FR_SERVO_CONE, fr->argv[1]);
+			}
+			if ( fr->argv[2] != FR_BATCH_KEEP ) {
+				SRV_drive(FR_SERVO_AERO, fr->argv[2]);
+			}
 			break;
 
 		default:
 			// shall never happen
-			SRV.in_fr.error = 1;
+			fr->error = 1;
 			break;
 	}
 
+	// the sender doesn't want any response
+	if ( OK != POOL_resp_wanted(fr) ) {
+		POOL_release(SRV.in_hdl);
+		PT_RESTART(pt);
+	}
+
 	// send the response
-	swap = SRV.in_fr.orig;
-	SRV.in_fr.orig = SRV.in_fr.dest;
-	SRV.in_fr.dest = swap;
-	SRV.in_fr.resp = 1;
-	//SRV.in_fr.nat = 0;
-	PT_WAIT_UNTIL(pt, OK == FIFO_put(&SRV.out, &SRV.in_fr));
+	swap = fr->orig;
+	fr->orig = fr->dest;
+	fr->dest = swap;
+	fr->resp = 1;
+	//fr->nat = 0;
+	PT_WAIT_UNTIL(pt, OK == POOL_put(&SRV.out, SRV.in_hdl));
 
 	// and restart waiting for incoming command
 	PT_RESTART(pt);
@@ -325,53 +469,53 @@ static PT_THREAD( SRV_in(pt_t* pt) )
 }
 
 
-static PT_THREAD( SRV_out(pt_t* pt) )
-{
-	PT_BEGIN(pt);
-
-	// wait until a frame to send is available
-	PT_WAIT_UNTIL(pt, OK == FIFO_get(&SRV.out, &SRV.out_fr));
-
-	// send it throught the dispatcher
-	DPT_lock(&SRV.interf);
-
-	// some retry may be necessary
-	PT_WAIT_UNTIL(pt, OK == DPT_tx(&SRV.interf, &SRV.out_fr));
-
-	// release the dispatcher
-	DPT_unlock(&SRV.interf);
-
-	// loop back at start
-	PT_RESTART(pt);
-
-	PT_END(pt);
-}
-
-
 // ------------------------------------------
 // public functions
 //
 
 void SRV_init(void)
 {
+	const cfg_t* cfg;
+
 	// init
 	FIFO_init(&SRV.in, &SRV.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
-	FIFO_init(&SRV.out, &SRV.out_buf, OUT_FIFO_SIZE, sizeof(frame_t));
+	POOL_fifo_init(&SRV.out, SRV.out_buf, OUT_FIFO_SIZE);
 
 	SRV.interf.channel = 10;
-	SRV.interf.cmde_mask = _CM(FR_MINUT_SERVO_CMD) | _CM(FR_MINUT_SERVO_INFO);
+	SRV.interf.cmde_mask = _CM(FR_MINUT_SERVO_CMD) | _CM(FR_MINUT_SERVO_INFO) | _CM(FR_MINUT_BATCH);
 	SRV.interf.queue = &SRV.in;
 	DPT_register(&SRV.interf);
 
 	PT_INIT(&SRV.pt_in);
 	PT_INIT(&SRV.pt_out);
 
+	SRV.backup = 0;
+	SRV.backup_fired = 0;
+
 	// configure port
 	SERVO_DDR |= SERVO_CONE;
 	SERVO_DDR |= SERVO_AERO;
 
+	// default positions are neutral, without slew limit nor auto-off
+	// unless set by the boot configuration
+	cfg = CFG_get();
+	if ( cfg ) {
+		SRV.cone.open_pos = cfg->cone_open;
+		SRV.cone.close_pos = cfg->cone_close;
+		SRV.cone.slew = cfg->cone_slew;
+		SRV.cone.hold = cfg->cone_hold;
+
+		SRV.aero.open_pos = cfg->aero_open;
+		SRV.aero.close_pos = cfg->aero_close;
+		SRV.aero.slew = cfg->aero_slew;
+		SRV.aero.hold = cfg->aero_hold;
+	}
+	SRV_precompute(&SRV.cone);
+	SRV_precompute(&SRV.aero);
+
 	// init the driver, by default, the pwm is zero
-	TMR1_init(TMR1_WITHOUT_INTERRUPT, TMR1_PRESCALER_8, TMR1_WGM_FAST_PWM_ICR1, COM1AB_1010, NULL, NULL);
+	// the overflow interrupt runs the motion profiles
+	TMR1_init(TMR1_WITH_OVERFLOW_INT, TMR1_PRESCALER_8, TMR1_WGM_FAST_PWM_ICR1, COM1AB_1010, SRV_tick, NULL);
 
 	TMR1_compare_set(TMR1_CAPT, 40000);
 
@@ -382,9 +526,77 @@ void SRV_init(void)
 
 void SRV_run(void)
 {
+	// time stamp the last cone move
+	if ( SRV.cone.stamp == SERVO_STAMP_TAKE ) {
+		SRV.cone.moved = TIME_get();
+		SRV.cone.stamp = SERVO_STAMP_NONE;
+	}
+
 	// if incoming command available
 	(void)PT_SCHEDULE(SRV_in(&SRV.pt_in));
 
 	// if outgoing frame to send
-	(void)PT_SCHEDULE(SRV_out(&SRV.pt_out));
+	(void)PT_SCHEDULE(POOL_send(&SRV.pt_out, &SRV.out, &SRV.interf));
+}
+
+
+void SRV_backup_arm(u16 delay)
+{
+	u8 sreg = SREG;
+
+	cli();
+	SRV.backup = delay * SERVO_PERIODS_PER_100MS;
+	SREG = sreg;
+}
+
+
+void SRV_backup_disarm(void)
+{
+	u8 sreg = SREG;
+
+	cli();
+	SRV.backup = 0;
+	SREG = sreg;
+}
+
+
+u8 SRV_backup_fired(void)
+{
+	return SRV.backup_fired;
+}
+
+
+u32 SRV_cone_moved(void)
+{
+	return SRV.cone.moved;
+}
+
+
+u8 SRV_sleep(void)
+{
+	u8 sreg = SREG;
+	u8 ret = KO;
+
+	cli();
+	if ( SRV.backup == 0
+			&& SRV.cone.cmp == SRV.cone.target && SRV.cone.hold_cnt == 0
+			&& SRV.aero.cmp == SRV.aero.target && SRV.aero.hold_cnt == 0 ) {
+		TIMSK1 &= ~_BV(TOIE1);
+		ret = OK;
+	}
+	SREG = sreg;
+
+	return ret;
+}
+
+
+void SRV_wake(void)
+{
+	TIMSK1 |= _BV(TOIE1);
+}
+
+
+u16 SRV_ram(void)
+{
+	return sizeof(SRV);
 }
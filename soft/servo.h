@@ -1,10 +1,36 @@
 #ifndef __SERVO_H__
 # define __SERVO_H__
 
+# include "type_def.h"
+
 
 // servo handling
 extern void SRV_init(void);
 
 extern void SRV_run(void);
 
+// arm the backup deployment : the cone is opened
+// from the TIMER1 interrupt once the delay [100 ms] is elapsed
+extern void SRV_backup_arm(u16 delay);
+
+// disarm the backup deployment, the main path has deployed
+extern void SRV_backup_disarm(void);
+
+// return 1 if the backup deployment has opened the cone
+extern u8 SRV_backup_fired(void);
+
+// time of the last cone PWM change toward a new position, 0 if none
+extern u32 SRV_cone_moved(void);
+
+// mask the PWM period interrupt if no servo is moving nor holding
+// and the backup is disarmed, return OK if masked
+extern u8 SRV_sleep(void);
+
+// unmask the PWM period interrupt, shall be called on wake-up
+// before any servo command
+extern void SRV_wake(void);
+
+// static RAM used by the module
+extern u16 SRV_ram(void);
+
 #endif	// __SERVO_H__
@@ -1,6 +1,9 @@
 #include "tk-off.h"
 
 #include "dispatcher.h"
+#include "pool.h"
+#include "cfg.h"
+#include "mark.h"
 
 #include "utils/pt.h"
 #include "utils/fifo.h"
@@ -14,6 +17,7 @@
 //
 
 #define IN_FIFO_SIZE	1
+#define OUT_FIFO_SIZE	2
 
 #define SAMPLEFREQ		100.0f	// Hz
 
@@ -23,12 +27,16 @@
 //
 
 struct {
-	pt_t pt;					// pt for sending thread
+	pt_t pt;					// pt for computation thread
+	pt_t pt_out;				// pt for sending thread
 	dpt_interface_t interf;		// interface to the dispatcher
 
 	frame_t in_buf[IN_FIFO_SIZE]; // incoming buffer and fifo for acquisitions or commands
 	fifo_t in_fifo;
 
+	pool_hdl_t out_buf[OUT_FIFO_SIZE];	// outgoing frames handles fifo
+	pool_fifo_t out_fifo;
+
 	frame_t fr;					// computation frame
 
 	u32 thr_time_out;			// time-out for threshold duration
@@ -171,11 +179,11 @@ static void TKF_Madgwick(void)
 }
 
 
-// update threshold configuration from incoming command
-static void TKF_config(void)
+// update threshold configuration
+static void TKF_config(u8 duration, u8 acc)
 {
-	TKF.thr_duration = TKF.fr.argv[0];	// threshold duration in 0.1s
-	TKF.acc_thr = TKF.fr.argv[1];		// acceleration threshold in 0.1G converted to [-16G; +16G]
+	TKF.thr_duration = duration;	// threshold duration in 0.1s
+	TKF.acc_thr = acc;				// acceleration threshold in 0.1G converted to [-16G; +16G]
 	TKF.acc_thr = TKF.acc_thr * 2048 / 10;
 }
 
@@ -208,8 +216,8 @@ static u8 TKF_compute(void)
 volatile	static s32 acc;
 static PT_THREAD( TKF_thread(pt_t* pt) )
 {
-	frame_t fr;
-	s16 gyr;
+	frame_t* fr;
+	pool_hdl_t hdl;
 
 	PT_BEGIN(pt);
 
@@ -235,14 +243,20 @@ static PT_THREAD( TKF_thread(pt_t* pt) )
 
 	// configuration of the threshold
 	case FR_TAKE_OFF_THRES:
-		TKF_config();
+		TKF_config(TKF.fr.argv[0], TKF.fr.argv[1]);
+
+		// the sender doesn't want any response
+		if ( OK != POOL_resp_wanted(&TKF.fr) ) {
+			break;
+		}
 
 		// send the response
-		u8 swap = TKF.fr.dest;
-		TKF.fr.dest = TKF.fr.orig;
-		TKF.fr.orig = swap;
-		TKF.fr.resp = 1;
-		PT_WAIT_UNTIL(pt, DPT_tx(&TKF.interf, &TKF.fr));
+		PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&TKF.out_fifo, &hdl)));
+		*fr = TKF.fr;
+		fr->dest = TKF.fr.orig;
+		fr->orig = TKF.fr.dest;
+		fr->resp = 1;
+		POOL_commit(&TKF.out_fifo, hdl);
 
 		break;
 
@@ -258,9 +272,12 @@ static PT_THREAD( TKF_thread(pt_t* pt) )
 		TKF.acc_z |= TKF.fr.argv[5] << 0;
 
 		if ( OK == TKF_compute() && ! TKF.take_off_resp_rxed ) {
+			MRK(MRK_TAKE_OFF);
+
 			// send the take-off frame
-			PT_WAIT_UNTIL(pt, frame_set_0(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_TAKE_OFF, 0)
-					&& DPT_tx(&TKF.interf, &fr));
+			PT_WAIT_UNTIL(pt, NULL != (fr = POOL_reserve(&TKF.out_fifo, &hdl)));
+			frame_set_0(fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_TAKE_OFF, 0);
+			POOL_commit(&TKF.out_fifo, hdl);
 		}
 
 		break;
@@ -296,8 +313,11 @@ static PT_THREAD( TKF_thread(pt_t* pt) )
 
 void TKF_init(void)
 {
+	const cfg_t* cfg;
+
 	// init
 	FIFO_init(&TKF.in_fifo, &TKF.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
+	POOL_fifo_init(&TKF.out_fifo, TKF.out_buf, OUT_FIFO_SIZE);
 
 	TKF.interf.channel = 8;
 	TKF.interf.cmde_mask = _CM(FR_TAKE_OFF) | _CM(FR_TAKE_OFF_THRES) | _CM(FR_DATA_ACC) | _CM(FR_DATA_GYR);
@@ -309,6 +329,12 @@ void TKF_init(void)
 	TKF.thr_duration = 255;	// 25.5s
 	TKF.acc_thr = 20;	// 2.0G
 
+	// unless set by the boot configuration
+	cfg = CFG_get();
+	if ( cfg ) {
+		TKF_config(cfg->thr_duration, cfg->acc_thr);
+	}
+
 	TKF.take_off_resp_rxed = 0;
 
 	// quaternion init
@@ -319,10 +345,20 @@ void TKF_init(void)
 	TKF.q3 = 0.0;
 
 	PT_INIT(&TKF.pt);
+	PT_INIT(&TKF.pt_out);
 }
 
 
 void TKF_run(void)
 {
 	(void)PT_SCHEDULE(TKF_thread(&TKF.pt));
+
+	// send outgoing frame(s) if any
+	(void)PT_SCHEDULE(POOL_send(&TKF.pt_out, &TKF.out_fifo, &TKF.interf));
+}
+
+
+u16 TKF_ram(void)
+{
+	return sizeof(TKF);
 }
@@ -1,10 +1,15 @@
 #ifndef __TK_OFF_H__
 # define __TK_OFF_H__
 
+# include "type_def.h"
+
 
 // take-off detection
 extern void TKF_init(void);
 
 extern void TKF_run(void);
 
+// static RAM used by the module
+extern u16 TKF_ram(void);
+
 #endif	// __TK_OFF_H__
@@ -0,0 +1,294 @@
+#include "tlm.h"
+
+#ifdef USE_TELEMETRY
+
+#include "dispatcher.h"
+
+#include "utils/fifo.h"
+#include "utils/time.h"
+
+#include "avr/io.h"
+#include "avr/interrupt.h"
+
+
+// ------------------------------------------
+// private definitions
+//
+
+#define IN_FIFO_SIZE	4
+#define PRIO_FIFO_SIZE	4		// state and event frames waiting for the UART
+
+#define TLM_FRAME_SIZE	sizeof(frame_t)
+#define TLM_BUF_SIZE	(3 * TLM_FRAME_SIZE)	// size of each of the 2 UART buffers
+
+#define TLM_UBRR		((16000000UL / 4 / TLM_BAUD - 1) / 2)	// @ 16 MHz in double speed mode
+
+// 8N1 : 10 bits per byte
+// the samples only get a share of the link so the state and event frames always find room
+#define TLM_SAMPLE_SHARE	75		// [%]
+#define TLM_SAMPLE_RATE		(TLM_BAUD / 10 * TLM_SAMPLE_SHARE / 100)	// [byte/s] so [mbyte/ms]
+#define TLM_CREDIT_MAX		(TLM_BUF_SIZE * 1000UL)	// [mbyte]
+
+#define TLM_REPORT_PERIOD	(1 * TIME_1_SEC)
+
+#define TLM_ACC			0
+#define TLM_GYR			1
+#define TLM_PRESS		2
+#define TLM_SAMPLE_NB	3
+
+
+// ------------------------------------------
+// private variables
+//
+
+struct {
+	dpt_interface_t interf;		// interface to the dispatcher
+
+	frame_t in_buf[IN_FIFO_SIZE];
+	fifo_t in_fifo;
+
+	frame_t prio_buf[PRIO_FIFO_SIZE];
+	fifo_t prio_fifo;
+
+	// latest sample of each type not yet sent
+	frame_t sample[TLM_SAMPLE_NB];
+	u8 waiting;					// 1 bit per sample type
+	u8 next;					// sample type served first
+
+	u32 credit;					// sample budget [mbyte]
+	u32 last;					// last budget update
+	u32 report;					// last dropped counts report
+
+	u16 dropped[TLM_SAMPLE_NB];			// overwritten samples of each type
+	u8 prio_dropped;			// lost state and event frames
+
+	// UART buffers
+	u8 buf[2][TLM_BUF_SIZE];
+	u8 fill;					// buffer filled by the superloop
+	u8 fill_len;
+	volatile u8 tx_len;			// buffer sent by the interrupt is the other one
+	volatile u8 tx_idx;
+	volatile u8 busy;
+} TLM;
+
+
+// ------------------------------------------
+// private functions
+//
+
+ISR(USART_UDRE_vect)
+{
+	UDR0 = TLM.buf[TLM.fill ^ 1][TLM.tx_idx];
+	TLM.tx_idx++;
+
+	// buffer sent
+	if ( TLM.tx_idx >= TLM.tx_len ) {
+		UCSR0B &= ~_BV(UDRIE0);
+		TLM.busy = 0;
+	}
+}
+
+
+// check if a frame fits in the buffer being filled
+static u8 TLM_room(void)
+{
+	return TLM.fill_len + TLM_FRAME_SIZE <= TLM_BUF_SIZE ? OK : KO;
+}
+
+
+static void TLM_add(frame_t* fr)
+{
+	const u8* p = (const u8*)fr;
+	u8 i;
+
+	for (i = 0; i < TLM_FRAME_SIZE; i++) {
+		TLM.buf[TLM.fill][TLM.fill_len + i] = p[i];
+	}
+	TLM.fill_len += TLM_FRAME_SIZE;
+}
+
+
+// hand the filled buffer to the interrupt once the previous one is sent
+static void TLM_kick(void)
+{
+	if ( TLM.busy || ! TLM.fill_len ) {
+		return;
+	}
+
+	TLM.tx_len = TLM.fill_len;
+	TLM.tx_idx = 0;
+	TLM.fill ^= 1;
+	TLM.fill_len = 0;
+
+	TLM.busy = 1;
+	UCSR0B |= _BV(UDRIE0);
+}
+
+
+static void TLM_rx(frame_t* fr)
+{
+	u8 type;
+
+	// responses are ignored
+	if ( fr->resp ) {
+		return;
+	}
+
+	switch ( fr->cmde ) {
+	case FR_DATA_ACC:
+	case FR_DATA_GYR:
+	case FR_DATA_PRESS:
+		switch ( fr->cmde ) {
+		case FR_DATA_ACC:
+			type = TLM_ACC;
+			break;
+		case FR_DATA_GYR:
+			type = TLM_GYR;
+			break;
+		default:
+			type = TLM_PRESS;
+			break;
+		}
+
+		// the previous sample is overwritten
+		if ( TLM.waiting & (1 << type) ) {
+			TLM.dropped[type]++;
+		}
+		TLM.sample[type] = *fr;
+		TLM.waiting |= 1 << type;
+		break;
+
+	case FR_MINUT_BATCH:
+		// only the state transitions are of interest
+		if ( fr->argv[0] == FR_BATCH_KEEP ) {
+			break;
+		}
+		// fall through
+
+	case FR_STATE:
+	case FR_TAKE_OFF:
+		if ( OK != FIFO_put(&TLM.prio_fifo, fr) && TLM.prio_dropped < 0xff ) {
+			TLM.prio_dropped++;
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+static void TLM_budget(void)
+{
+	u32 ms;
+
+	ms = (TIME_get() - TLM.last) / TIME_1_MSEC;
+	TLM.last += ms * TIME_1_MSEC;
+
+	TLM.credit += ms * TLM_SAMPLE_RATE;
+	if ( TLM.credit > TLM_CREDIT_MAX ) {
+		TLM.credit = TLM_CREDIT_MAX;
+	}
+}
+
+
+static void TLM_fill(void)
+{
+	frame_t fr;
+	u8 type;
+	u8 i;
+
+	// state and event frames first
+	while ( OK == TLM_room() && OK == FIFO_get(&TLM.prio_fifo, &fr) ) {
+		TLM_add(&fr);
+	}
+
+	// dropped counts
+	if ( TIME_get() - TLM.report >= TLM_REPORT_PERIOD && OK == TLM_room() ) {
+		TLM.report += TLM_REPORT_PERIOD;
+
+		frame_set_6(&fr, DPT_SELF_ADDR, DPT_SELF_ADDR, FR_MINUT_TELEMETRY, 0,
+				(TLM.dropped[TLM_ACC] & 0xff00) >> 8, (TLM.dropped[TLM_ACC] & 0x00ff) >> 0,
+				(TLM.dropped[TLM_GYR] & 0xff00) >> 8, (TLM.dropped[TLM_GYR] & 0x00ff) >> 0,
+				TLM.prio_dropped,
+				TLM.dropped[TLM_PRESS] > 0xff ? 0xff : TLM.dropped[TLM_PRESS]);
+		TLM_add(&fr);
+	}
+
+	// then the samples within the budget, all types in turn
+	for (i = 0; i < TLM_SAMPLE_NB; i++) {
+		type = (TLM.next + i) % TLM_SAMPLE_NB;
+
+		if ( ! (TLM.waiting & (1 << type)) ) {
+			continue;
+		}
+
+		if ( TLM.credit < TLM_FRAME_SIZE * 1000UL || OK != TLM_room() ) {
+			break;
+		}
+
+		TLM_add(&TLM.sample[type]);
+		TLM.waiting &= ~(1 << type);
+		TLM.credit -= TLM_FRAME_SIZE * 1000UL;
+		TLM.next = (type + 1) % TLM_SAMPLE_NB;
+	}
+}
+
+
+// ------------------------------------------
+// public functions
+//
+
+void TLM_init(void)
+{
+	FIFO_init(&TLM.in_fifo, &TLM.in_buf, IN_FIFO_SIZE, sizeof(frame_t));
+	FIFO_init(&TLM.prio_fifo, &TLM.prio_buf, PRIO_FIFO_SIZE, sizeof(frame_t));
+
+	TLM.interf.channel = 14;
+	TLM.interf.cmde_mask = _CM(FR_DATA_ACC) | _CM(FR_DATA_GYR) | _CM(FR_DATA_PRESS) | _CM(FR_MINUT_BATCH) | _CM(FR_STATE) | _CM(FR_TAKE_OFF);
+	TLM.interf.queue = &TLM.in_fifo;
+	DPT_register(&TLM.interf);
+
+	TLM.waiting = 0;
+	TLM.next = TLM_ACC;
+	TLM.credit = 0;
+	TLM.last = TIME_get();
+	TLM.report = TLM.last;
+	TLM.dropped[TLM_ACC] = 0;
+	TLM.dropped[TLM_GYR] = 0;
+	TLM.dropped[TLM_PRESS] = 0;
+	TLM.prio_dropped = 0;
+
+	TLM.fill = 0;
+	TLM.fill_len = 0;
+	TLM.busy = 0;
+
+	// 8N1, transmitter only
+	UBRR0H = (TLM_UBRR & 0xff00) >> 8;
+	UBRR0L = (TLM_UBRR & 0x00ff) >> 0;
+	UCSR0A = _BV(U2X0);
+	UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+	UCSR0B = _BV(TXEN0);
+}
+
+
+void TLM_run(void)
+{
+	frame_t fr;
+
+	while ( OK == FIFO_get(&TLM.in_fifo, &fr) ) {
+		TLM_rx(&fr);
+	}
+
+	TLM_budget();
+	TLM_fill();
+	TLM_kick();
+}
+
+
+u16 TLM_ram(void)
+{
+	return sizeof(TLM);
+}
+
+#endif	// USE_TELEMETRY
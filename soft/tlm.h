@@ -0,0 +1,52 @@
+#ifndef __TLM_H__
+# define __TLM_H__
+
+# include "type_def.h"
+
+
+// telemetry downlink
+//
+// the UART is driven by a UDRE interrupt from 2 buffers :
+// the superloop fills one while the other is being sent.
+// the frames are sent as their raw bytes (see frame_t).
+//
+// the state and event frames always go first.
+// the IMU and barometer samples only use a share of the link bandwidth :
+// when there is no budget left, the latest sample of each type
+// overwrites the previous one not yet sent, which is counted as dropped.
+// the dropped counts are sent every second in a FR_MINUT_TELEMETRY frame :
+//	- argv[0..1] : dropped acceleration samples
+//	- argv[2..3] : dropped gyroscope samples
+//	- argv[4] : dropped state and event frames
+//	- argv[5] : dropped pressure samples (saturated at 255)
+//
+// the telemetry takes the UART from the NAT,
+// so the ground can't send any frame to the node.
+
+
+// ------------------------------------------
+// public definitions
+//
+
+// uncomment the define below to give the UART to the telemetry instead of the NAT
+//#define USE_TELEMETRY
+
+#define TLM_BAUD		115200UL	// link speed [bit/s]
+
+
+// ------------------------------------------
+// public functions
+//
+
+#ifdef USE_TELEMETRY
+
+extern void TLM_init(void);
+
+extern void TLM_run(void);
+
+// static RAM used by the module
+extern u16 TLM_ram(void);
+
+#endif
+
+#endif	// __TLM_H__